@@ -492,6 +492,9 @@ GC_stop_func stop_func;
 #   if defined(REGISTER_LIBRARIES_EARLY)
         GC_cond_register_dynamic_libraries();
 #   endif
+    if (GC_stop_world_call_back != (void (*) GC_PROTO((void)))0) {
+	(*GC_stop_world_call_back)();
+    }
     STOP_WORLD();
     IF_THREADS(GC_world_stopped = TRUE);
 #   ifdef CONDPRINT
@@ -526,6 +529,10 @@ GC_stop_func stop_func;
 		    GC_deficit = i; /* Give the mutator a chance. */
                     IF_THREADS(GC_world_stopped = FALSE);
 	            START_WORLD();
+		    if (GC_start_world_call_back
+			!= (void (*) GC_PROTO((void)))0) {
+			(*GC_start_world_call_back)();
+		    }
 	            return(FALSE);
 	    }
 	    if (GC_mark_some((ptr_t)(&dummy))) break;
@@ -560,6 +567,9 @@ GC_stop_func stop_func;
     
     IF_THREADS(GC_world_stopped = FALSE);
     START_WORLD();
+    if (GC_start_world_call_back != (void (*) GC_PROTO((void)))0) {
+	(*GC_start_world_call_back)();
+    }
 #   ifdef PRINTTIMES
 	GET_TIME(current_time);
 	GC_printf1("World-stopped marking took %lu msecs\n",
@@ -405,6 +405,16 @@ GC_API size_t GC_get_bytes_since_gc GC_PROTO((void));
 /* Never decreases, except due to wrapping.				*/
 GC_API size_t GC_get_total_bytes GC_PROTO((void));
 
+/* Call proc on each object that the last collection found reachable,	*/
+/* with its size in bytes and the kind it was allocated with.  Objects	*/
+/* allocated since that collection are not seen, so call GC_gcollect()	*/
+/* first for a census of the live heap.  Acquires the allocation lock;	*/
+/* proc must not allocate.						*/
+typedef void (*GC_reachable_object_proc)
+	GC_PROTO((GC_PTR obj, size_t bytes, int kind, GC_PTR client_data));
+GC_API void GC_enumerate_reachable_objects
+	GC_PROTO((GC_reachable_object_proc proc, GC_PTR client_data));
+
 /* Disable garbage collection.  Even GC_gcollect calls will be 		*/
 /* ineffective.								*/
 GC_API void GC_disable GC_PROTO((void));
@@ -1361,6 +1361,13 @@ extern void (*GC_start_call_back) GC_PROTO((void));
   			/* Not called if 0.  Called with allocation 	*/
   			/* lock held.					*/
   			/* 0 by default.				*/
+extern void (*GC_stop_world_call_back) GC_PROTO((void));
+extern void (*GC_start_world_call_back) GC_PROTO((void));
+  			/* Called just before the world is stopped for	*/
+  			/* marking, and just after it is restarted, so	*/
+  			/* that clients can time the pauses.  Not	*/
+  			/* called if 0.  Called with allocation lock	*/
+  			/* held; must not allocate.  0 by default.	*/
 # if defined(USE_GENERIC_PUSH_REGS)
   void GC_generic_push_regs GC_PROTO((ptr_t cold_gc_frame));
 # else
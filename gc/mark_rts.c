@@ -368,18 +368,14 @@ ptr_t p;
 
 ptr_t GC_approx_sp()
 {
-    VOLATILE word dummy;
+    VOLATILE word sp;
 
-    dummy = 42;	/* Force stack to grow if necessary.	Otherwise the	*/
+    sp = (word)&sp;
+		/* Also force stack to grow if necessary. Otherwise the	*/
     		/* later accesses might cause the kernel to think we're	*/
-    		/* doing something wrong.				*/
-#   ifdef _MSC_VER
-#     pragma warning(disable:4172)
-#   endif
-    return((ptr_t)(&dummy));
-#   ifdef _MSC_VER
-#     pragma warning(default:4172)
-#   endif
+		/* doing something wrong.  Going through the volatile	*/
+		/* keeps gcc from folding the address of a local to 0.	*/
+    return((ptr_t)sp);
 }
 
 /*
@@ -100,6 +100,10 @@ void (*GC_print_all_smashed) GC_PROTO((void)) = (void (*) GC_PROTO((void)))0;
 
 void (*GC_start_call_back) GC_PROTO((void)) = (void (*) GC_PROTO((void)))0;
 
+void (*GC_stop_world_call_back) GC_PROTO((void)) = (void (*) GC_PROTO((void)))0;
+
+void (*GC_start_world_call_back) GC_PROTO((void)) = (void (*) GC_PROTO((void)))0;
+
 ptr_t GC_stackbottom = 0;
 
 #ifdef IA64
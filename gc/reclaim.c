@@ -899,6 +899,53 @@ void GC_print_block_list()
 
 #endif /* NO_DEBUGGING */
 
+struct enumerate_reachable_s {
+    GC_reachable_object_proc proc;
+    GC_PTR client_data;
+};
+
+/*ARGSUSED*/
+# if defined(__STDC__) || defined(__cplusplus)
+    static void GC_do_enumerate_reachable_objects(struct hblk *hbp,
+    						  word ped)
+# else
+    static void GC_do_enumerate_reachable_objects(hbp, ped)
+    struct hblk *hbp;
+    word ped;
+# endif
+{
+    register hdr * hhdr = HDR(hbp);
+    register word sz = hhdr -> hb_sz;
+    register word word_no;
+    struct enumerate_reachable_s *ed = (struct enumerate_reachable_s *)ped;
+
+    if (GC_block_empty(hhdr)) return;
+    for (word_no = 0; word_no + sz <= BYTES_TO_WORDS(HBLKSIZE)
+    		      || word_no == 0; word_no += sz) {
+	if (mark_bit_from_hdr(hhdr, word_no)) {
+	    (*ed -> proc)((GC_PTR)((word *)hbp + word_no),
+	    		  (size_t)WORDS_TO_BYTES(sz),
+	    		  (int)(hhdr -> hb_obj_kind), ed -> client_data);
+	}
+    }
+}
+
+void GC_enumerate_reachable_objects(proc, client_data)
+GC_reachable_object_proc proc;
+GC_PTR client_data;
+{
+    struct enumerate_reachable_s ed;
+    DCL_LOCK_STATE;
+
+    ed.proc = proc;
+    ed.client_data = client_data;
+    DISABLE_SIGNALS();
+    LOCK();
+    GC_apply_to_all_blocks(GC_do_enumerate_reachable_objects, (word)&ed);
+    UNLOCK();
+    ENABLE_SIGNALS();
+}
+
 /*
  * Clear all obj_link pointers in the list of free objects *flp.
  * Clear *flp.
@@ -35,7 +35,7 @@ main(int argc, char *argv[])
   init_posix_file (global_env);
   init_posix_proc (global_env);
   init_posix_popen (global_env);
-  GC_expand_hp (200);
+  GC_expand_hp (200 * 4096);
 
   /* load any files given on the command line */
   for ( i=1 ; i<argc ; ++i )
@@ -60,6 +60,7 @@
 #include <dirent.h>
 #include <fcntl.h>
 #include <stdio.h>
+#include <errno.h>
 
 #ifndef S_ENFMT
 #  define S_ENFMT S_ISGID
@@ -91,6 +92,8 @@ static Scheme_Object *posix_rewinddir (int argc, Scheme_Object *argv[]);
 static Scheme_Object *posix_open (int argc, Scheme_Object *argv[]);
 static Scheme_Object *posix_read (int argc, Scheme_Object *argv[]);
 static Scheme_Object *posix_write (int argc, Scheme_Object *argv[]);
+static Scheme_Object *posix_read_bytevector (int argc, Scheme_Object *argv[]);
+static Scheme_Object *posix_write_bytevector (int argc, Scheme_Object *argv[]);
 static Scheme_Object *posix_fcntl (int argc, Scheme_Object *argv[]);
 static Scheme_Object *posix_lseek (int argc, Scheme_Object *argv[]);
 static Scheme_Object *posix_dup (int argc, Scheme_Object *argv[]);
@@ -120,8 +123,8 @@ void
 init_posix_file (Scheme_Env *env)
 {
   /* types */
-  posix_stat_type = scheme_make_type ("<stat>");
-  posix_dir_type = scheme_make_type ("<dir>");
+  posix_stat_type = scheme_make_layout_type ("<stat>", SCHEME_LAYOUT_PTR1);
+  posix_dir_type = scheme_make_layout_type ("<dir>", SCHEME_LAYOUT_NONE);
 
   /* functions */
   scheme_add_global("posix-getcwd", scheme_make_prim (posix_getcwd), env);
@@ -142,6 +145,8 @@ init_posix_file (Scheme_Env *env)
   scheme_add_global("posix-open", scheme_make_prim (posix_open), env);
   scheme_add_global("posix-read", scheme_make_prim (posix_read), env);
   scheme_add_global("posix-write", scheme_make_prim (posix_write), env);
+  scheme_add_global("posix-read-bytevector!", scheme_make_prim (posix_read_bytevector), env);
+  scheme_add_global("posix-write-bytevector", scheme_make_prim (posix_write_bytevector), env);
   scheme_add_global("posix-fcntl", scheme_make_prim (posix_fcntl), env);
   scheme_add_global("posix-lseek", scheme_make_prim (posix_lseek), env);
   scheme_add_global("posix-dup", scheme_make_prim (posix_dup), env);
@@ -205,20 +210,32 @@ make_stat_object (struct stat *s)
 {
   Scheme_Object *stat_obj;
 
-  stat_obj = scheme_alloc_object ();
-  SCHEME_TYPE (stat_obj) = posix_stat_type;
+  stat_obj = scheme_alloc_typed_object (posix_stat_type);
   SCHEME_PTR_VAL (stat_obj) = s;
   return (stat_obj);
 }
 
+/* A dir object that is dropped without posix-closedir closes its
+   DIR when it is collected. */
+
+static void
+finalize_dir (void *dir_obj, void *data)
+{
+  DIR *dirp;
+
+  dirp = SCHEME_PTR_VAL ((Scheme_Object *) dir_obj);
+  if (dirp)
+    closedir (dirp);
+}
+
 static Scheme_Object *
 make_dir_object (DIR *dirp)
 {
   Scheme_Object *dir_obj;
 
-  dir_obj = scheme_alloc_object ();
-  SCHEME_TYPE (dir_obj) = posix_dir_type;
+  dir_obj = scheme_alloc_typed_object (posix_dir_type);
   SCHEME_PTR_VAL (dir_obj) = dirp;
+  scheme_register_finalizer (dir_obj, finalize_dir, NULL);
   return (dir_obj);
 }
 
@@ -343,7 +360,7 @@ posix_stat (int argc, Scheme_Object *argv[])
   SCHEME_ASSERT ((argc == 1), "posix-stat: wrong number of args");
   SCHEME_ASSERT (SCHEME_STRINGP(argv[0]), "posix-stat: arg must be a string");
   path = SCHEME_STR_VAL (argv[0]);
-  s = scheme_malloc (sizeof (struct stat));
+  s = scheme_malloc_atomic (sizeof (struct stat));
   if (stat (path, s) != 0)
     {
       scheme_signal_error ("posix-stat: could not stat file: %s", path);
@@ -378,7 +395,14 @@ posix_opendir (int argc, Scheme_Object *argv[])
   SCHEME_ASSERT ((argc == 1), "posix-opendir: wrong number of args");
   SCHEME_ASSERT (SCHEME_STRINGP(argv[0]), "posix-opendir: arg must be a string");
   name = SCHEME_STR_VAL (argv[0]);
-  if ((dirp = opendir (name)) == NULL)
+  dirp = opendir (name);
+  if (dirp == NULL && (errno == EMFILE || errno == ENFILE))
+    {
+      /* let dropped dir objects give back their descriptors */
+      scheme_gc_collect ();
+      dirp = opendir (name);
+    }
+  if (dirp == NULL)
     {
       scheme_signal_error ("posix-opendir: could not open directory: %s", name);
     }
@@ -394,6 +418,7 @@ posix_readdir (int argc, Scheme_Object *argv[])
   SCHEME_ASSERT ((argc == 1), "posix-readdir: wrong number of args");
   SCHEME_ASSERT (POSIX_DIRP(argv[0]), "posix-readdir: arg must be a dir object");
   dirp = SCHEME_PTR_VAL (argv[0]);
+  SCHEME_ASSERT (dirp, "posix-readdir: dir is closed");
   direntp = readdir (dirp);
   if (direntp == NULL)
     {
@@ -414,7 +439,11 @@ posix_closedir (int argc, Scheme_Object *argv[])
   SCHEME_ASSERT ((argc == 1), "posix-closedir: wrong number of args");
   SCHEME_ASSERT (POSIX_DIRP(argv[0]), "posix-closedir: arg must be a dir object");
   dirp = SCHEME_PTR_VAL (argv[0]);
-  closedir (dirp);
+  if (dirp)
+    {
+      closedir (dirp);
+      SCHEME_PTR_VAL (argv[0]) = NULL;
+    }
   return (scheme_true);
 }
 
@@ -427,6 +456,7 @@ posix_rewinddir (int argc, Scheme_Object *argv[])
   SCHEME_ASSERT ((argc == 1), "posix-rewinddir: wrong number of args");
   SCHEME_ASSERT (POSIX_DIRP(argv[0]), "posix-rewinddir: arg must be a dir object");
   dirp = SCHEME_PTR_VAL (argv[0]);
+  SCHEME_ASSERT (dirp, "posix-rewinddir: dir is closed");
   rewinddir (dirp);
   return (scheme_true);
 }
@@ -453,7 +483,7 @@ posix_open (int argc, Scheme_Object *argv[])
 static Scheme_Object *
 posix_read (int argc, Scheme_Object *argv[])
 {
-  int fd, num_bytes;
+  int fd, num_bytes, num_read;
   Scheme_Object *str;
 
   SCHEME_ASSERT ((argc == 2), "posix-read: wrong number of args");
@@ -463,10 +493,13 @@ posix_read (int argc, Scheme_Object *argv[])
   num_bytes = SCHEME_INT_VAL (argv[1]);
 
   str = scheme_alloc_string (num_bytes, '\0');
-  if (read (fd, SCHEME_STR_VAL(str), num_bytes) == -1)
+  num_read = read (fd, SCHEME_STR_VAL(str), num_bytes);
+  if (num_read == -1)
     {
       scheme_signal_error ("posix-read: could not read from file descriptor %d", fd);
     }
+  SCHEME_STR_LEN (str) = num_read;
+  SCHEME_STR_VAL (str)[num_read] = '\0';
   return (str);
 }
 
@@ -481,7 +514,7 @@ posix_write (int argc, Scheme_Object *argv[])
   SCHEME_ASSERT (SCHEME_STRINGP(argv[1]), "posix-write: second arg must be a string");
   fd = SCHEME_INT_VAL (argv[0]);
   str = SCHEME_STR_VAL (argv[1]);
-  len = strlen (str);
+  len = SCHEME_STR_LEN (argv[1]);
   if (write (fd, str, len) == -1)
     {
       scheme_signal_error ("posix-write: could not write to descriptor %d", fd);
@@ -489,6 +522,50 @@ posix_write (int argc, Scheme_Object *argv[])
   return (scheme_true);
 }
 
+/* (posix-read-bytevector! fd bv [start [end]]) reads into the
+   bytevector in place and returns the byte count, 0 at end of file. */
+static Scheme_Object *
+posix_read_bytevector (int argc, Scheme_Object *argv[])
+{
+  int fd, start, end, num_read;
+
+  SCHEME_ASSERT ((argc >= 2 && argc <= 4), "posix-read-bytevector!: wrong number of args");
+  SCHEME_ASSERT (SCHEME_INTP(argv[0]), "posix-read-bytevector!: first arg must be an integer");
+  SCHEME_ASSERT (SCHEME_U8VECTORP(argv[1]), "posix-read-bytevector!: second arg must be a bytevector");
+  scheme_numvec_range ("posix-read-bytevector!", argv[1], argc, argv, 2, &start, &end);
+  fd = SCHEME_INT_VAL (argv[0]);
+  num_read = read (fd, SCHEME_U8VEC_ELS(argv[1]) + start, end - start);
+  if (num_read == -1)
+    {
+      scheme_signal_error ("posix-read-bytevector!: could not read from file descriptor %d", fd);
+    }
+  return (scheme_make_integer (num_read));
+}
+
+static Scheme_Object *
+posix_write_bytevector (int argc, Scheme_Object *argv[])
+{
+  int fd, start, end, num_written;
+  unsigned char *buf;
+
+  SCHEME_ASSERT ((argc >= 2 && argc <= 4), "posix-write-bytevector: wrong number of args");
+  SCHEME_ASSERT (SCHEME_INTP(argv[0]), "posix-write-bytevector: first arg must be an integer");
+  SCHEME_ASSERT (SCHEME_U8VECTORP(argv[1]), "posix-write-bytevector: second arg must be a bytevector");
+  scheme_numvec_range ("posix-write-bytevector", argv[1], argc, argv, 2, &start, &end);
+  fd = SCHEME_INT_VAL (argv[0]);
+  buf = SCHEME_U8VEC_ELS (argv[1]);
+  while (start < end)
+    {
+      num_written = write (fd, buf + start, end - start);
+      if (num_written == -1)
+	{
+	  scheme_signal_error ("posix-write-bytevector: could not write to descriptor %d", fd);
+	}
+      start += num_written;
+    }
+  return (scheme_true);
+}
+
 static Scheme_Object *
 posix_fcntl (int argc, Scheme_Object *argv[])
 {
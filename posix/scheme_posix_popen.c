@@ -1,13 +1,39 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <errno.h>
 #include <string.h>
 #include <assert.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/wait.h>
 
 #include "scheme.h"
 #include "scheme_posix.h"
 
+/* Pipes are opened here rather than with popen(), so that the pid of
+   each child is known.  posix-pclose and close-port wait for the
+   child, as pclose() does.  The finalizer of a pipe dropped without
+   either must not wait, so it closes the pipe without blocking and
+   reaps the child only if it has exited; any others are kept and
+   reaped when a later pipe is opened or closed. */
+
+struct Pipe
+{
+  FILE *fp;
+  pid_t pid;
+  struct Pipe *next;
+};
+
+static struct Pipe *open_pipes;
+static struct Pipe *unreaped;
+
 static Scheme_Object *posix_popen (int argc, Scheme_Object *argv[]);
 static Scheme_Object *posix_pclose (int argc, Scheme_Object *argv[]);
+static FILE *open_pipe (char *command, int direction);
+static int close_pipe (FILE *fp, int wait);
+static void reap_children (void);
+static void finalize_pipe (void *port, void *data);
 
 void
 init_posix_popen (Scheme_Env *env)
@@ -16,18 +42,165 @@ init_posix_popen (Scheme_Env *env)
   scheme_add_global ("posix-pclose", scheme_make_prim (posix_pclose), env);
 }
 
+/* Runs command with its stdout (direction 0) or stdin (direction 1)
+   on a pipe, and returns the other end. */
+
+static FILE *
+open_pipe (char *command, int direction)
+{
+  int fds[2], child_end, parent_end, target;
+  pid_t pid;
+  FILE *fp;
+  struct Pipe *p;
+
+  reap_children ();
+  if (pipe (fds) == -1)
+    {
+      return (NULL);
+    }
+  child_end = fds[direction ? 0 : 1];
+  parent_end = fds[direction ? 1 : 0];
+  target = (direction ? STDIN_FILENO : STDOUT_FILENO);
+  pid = fork ();
+  if (pid == -1)
+    {
+      close (fds[0]);
+      close (fds[1]);
+      return (NULL);
+    }
+  if (pid == 0)
+    {
+      if (child_end != target)
+	{
+	  dup2 (child_end, target);
+	  close (child_end);
+	}
+      close (parent_end);
+      execl ("/bin/sh", "sh", "-c", command, (char *) NULL);
+      _exit (127);
+    }
+  close (child_end);
+  fcntl (parent_end, F_SETFD, FD_CLOEXEC);
+  fp = fdopen (parent_end, (direction ? "w" : "r"));
+  p = (struct Pipe *) malloc (sizeof (struct Pipe));
+  if (! fp || ! p)
+    {
+      free (p);
+      if (fp)
+	fclose (fp);
+      else
+	close (parent_end);
+      waitpid (pid, NULL, 0);
+      errno = ENOMEM;
+      return (NULL);
+    }
+  p->fp = fp;
+  p->pid = pid;
+  p->next = open_pipes;
+  open_pipes = p;
+  return (fp);
+}
+
+/* Closes fp, and returns the child's exit status if wait is nonzero,
+   waiting for it to exit.  Otherwise fp is closed without blocking,
+   and a child that has not exited is left on the unreaped list. */
+
+static int
+close_pipe (FILE *fp, int wait)
+{
+  struct Pipe **pp, *p;
+  int status;
+  pid_t ret;
+
+  for ( pp=&open_pipes ; *pp && (*pp)->fp != fp ; pp=&(*pp)->next )
+    ;
+  p = *pp;
+  assert (p);
+  *pp = p->next;
+  if (! wait)
+    {
+      /* flushing what is left must not wait for a reader */
+      fcntl (fileno (fp), F_SETFL, O_NONBLOCK);
+    }
+  fclose (fp);
+  p->fp = NULL;
+  do
+    {
+      ret = waitpid (p->pid, &status, (wait ? 0 : WNOHANG));
+    }
+  while (ret == -1 && errno == EINTR);
+  if (ret == 0)
+    {
+      p->next = unreaped;
+      unreaped = p;
+    }
+  else
+    {
+      free (p);
+    }
+  reap_children ();
+  return (ret == -1 ? -1 : status);
+}
+
+static void
+reap_children (void)
+{
+  struct Pipe **pp, *p;
+
+  pp = &unreaped;
+  while (*pp)
+    {
+      p = *pp;
+      if (waitpid (p->pid, NULL, WNOHANG) == 0)
+	{
+	  pp = &p->next;
+	}
+      else
+	{
+	  *pp = p->next;
+	  free (p);
+	}
+    }
+}
+
+static void
+finalize_pipe (void *port, void *data)
+{
+  Scheme_Input_Port *iport;
+  Scheme_Output_Port *oport;
+
+  if (SCHEME_INPORTP ((Scheme_Object *) port))
+    {
+      iport = (Scheme_Input_Port *) SCHEME_PTR_VAL ((Scheme_Object *) port);
+      if (iport->port_data)
+	{
+	  close_pipe ((FILE *) iport->port_data, 0);
+	  iport->port_data = NULL;
+	}
+    }
+  else
+    {
+      oport = (Scheme_Output_Port *) SCHEME_PTR_VAL ((Scheme_Object *) port);
+      if (oport->port_data)
+	{
+	  close_pipe ((FILE *) oport->port_data, 0);
+	  oport->port_data = NULL;
+	}
+    }
+}
+
 static void
 pipe_pclose_input (Scheme_Input_Port *inport)
 {
   FILE *fp = (FILE *) inport->port_data;
-  pclose (fp);
+  close_pipe (fp, 1);
 }
 
 static void
 pipe_pclose_output (Scheme_Output_Port *outport)
 {
   FILE *fp = (FILE *) outport->port_data;
-  pclose (fp);
+  close_pipe (fp, 1);
 }
 
 Scheme_Object *
@@ -60,7 +233,13 @@ posix_popen (int argc, Scheme_Object *argv[])
   else
     SCHEME_ASSERT (0, "posix-popen: wrong type");
 
-  fp = popen (fpath, fmode);
+  fp = open_pipe (fpath, direction);
+  if (NULL == fp && (errno == EMFILE || errno == ENFILE || errno == EAGAIN))
+    {
+      /* let dropped pipes give back their descriptors and children */
+      scheme_gc_collect ();
+      fp = open_pipe (fpath, direction);
+    }
   if (NULL == fp)
     {
       scheme_signal_error ("posix-popen: %s", strerror(errno));
@@ -79,6 +258,8 @@ posix_popen (int argc, Scheme_Object *argv[])
       break;
     default: assert (0);
     }
+  /* in place of the file port's, which would wait for the child */
+  scheme_register_finalizer (obj, finalize_pipe, NULL);
   return obj;
 }
 
@@ -96,18 +277,26 @@ posix_pclose (int argc, Scheme_Object *argv[])
   if (SCHEME_INPORTP (argv[0]))
     {
       iport = (Scheme_Input_Port *) SCHEME_PTR_VAL (argv[0]);
+      SCHEME_ASSERT ((iport->close_fun == pipe_pclose_input), "posix-pclose: port is not a pipe");
       fp = iport->port_data;
     }
   else if (SCHEME_OUTPORTP (argv[0]))
     {
       oport = (Scheme_Output_Port *) SCHEME_PTR_VAL (argv[0]);
+      SCHEME_ASSERT ((oport->close_fun == pipe_pclose_output), "posix-pclose: port is not a pipe");
       fp = oport->port_data;
     }
   else
     SCHEME_ASSERT (0, "posix-pclose: arg must be a port");
   
-  assert (fp);
-  ret = pclose (fp);
+  SCHEME_ASSERT (fp, "posix-pclose: port is already closed");
+  ret = close_pipe (fp, 1);
+
+  /* so that neither close-port nor the port's finalizer closes it again */
+  if (SCHEME_INPORTP (argv[0]))
+    iport->port_data = NULL;
+  else
+    oport->port_data = NULL;
 
   if ( ret == -1 )
     {
@@ -3,7 +3,34 @@
     (let loop ((file (posix-readdir dir)))
       (if file
 	  (cons file (loop (posix-readdir dir)))
-	  '()))))
+	  (begin (posix-closedir dir) '())))))
 
 (write (directory "."))
 (newline)
+
+;; dir objects dropped without posix-closedir close their DIR once
+;; collected, so this opens far more than the descriptor limit allows
+(define (open-and-drop n)
+  (if (> n 0)
+      (begin (posix-opendir ".") (open-and-drop (- n 1)))
+      #t))
+
+(write (open-and-drop 5000))
+(newline)
+
+(define p (posix-popen "echo hello" "r"))
+(write (read p))
+(write (posix-pclose p))
+(newline)
+
+;; and so do pipes dropped without posix-pclose, without waiting for
+;; the child, so the sleeps do not add up
+(define (popen-and-drop n command mode)
+  (if (> n 0)
+      (begin (posix-popen command mode) (popen-and-drop (- n 1) command mode))
+      #t))
+
+(write (popen-and-drop 2000 "true" "r"))
+(write (popen-and-drop 200 "sleep 1" "r"))
+(write (popen-and-drop 200 "cat >/dev/null" "w"))
+(newline)
@@ -35,7 +35,7 @@ main(int argc, char *argv[])
   global_env = scheme_basic_env ();
   scheme_init_regexp (global_env);
   scheme_default_handler ();
-  GC_expand_hp (200);
+  GC_expand_hp (200 * 4096);
 
   /* load any files given on the command line */
   for ( i=1 ; i<argc ; ++i )
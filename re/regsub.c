@@ -37,7 +37,7 @@ const char *source;
 	}
 
 	int bufsiz = BUFSIZ; /* record space alloced for destination buffer */
-	char *destbuf = scheme_malloc (bufsiz);
+	char *destbuf = scheme_malloc_atomic (bufsiz);
 	dst=destbuf;
 	char *newptr;
 
@@ -35,7 +35,7 @@ void
 scheme_init_regexp (Scheme_Env *env)
 {
   /* types */
-  scheme_regexp_type = scheme_make_type ("<regexp>");
+  scheme_regexp_type = scheme_make_layout_type ("<regexp>", SCHEME_LAYOUT_PTR1);
 
   /* functions */
   scheme_add_global ("regexp?", scheme_make_prim (scheme_regexp_p), env);
@@ -71,8 +71,7 @@ scheme_regexp (int argc, Scheme_Object *argv[])
   if (re == NULL)
     scheme_signal_error ("regexp: failed");
 
-  so_re = scheme_alloc_object ();
-  SCHEME_TYPE (so_re) = scheme_regexp_type;
+  so_re = scheme_alloc_typed_object (scheme_regexp_type);
   SCHEME_PTR_VAL (so_re) = re;
   return (so_re);
 }
@@ -211,11 +210,11 @@ scheme_regexp_replace_range (int argc, Scheme_Object *argv[])
 	break;
     }
 
-  int postlen = strlen (tgt);
+  int postlen = target + SCHEME_STR_LEN (argv[1]) - tgt;
   SCHEME_ASSERT (buf + postlen < result + BUFSIZ, "regexp-releace-range: buffer overflow");
-  strcpy (buf, tgt);
+  memcpy (buf, tgt, postlen);
+  buf += postlen;
 
-  so_result = scheme_alloc_string (strlen (result) + 1, '\0');
-  strcpy (SCHEME_STR_VAL (so_result), result);
+  so_result = scheme_make_sized_string (result, buf - result);
   return so_result;
 }
@@ -29,6 +29,7 @@
 #include <setjmp.h>
 #include <stdarg.h>
 #include <stdlib.h>
+#include <stdint.h>
 
 #ifdef __cplusplus
 extern "C" 
@@ -50,13 +51,40 @@ struct Scheme_Hash_Table
 };
 typedef struct Scheme_Hash_Table Scheme_Hash_Table;
 
+/* A hash table on objects, by eq?, that does not keep its keys
+   alive: once a key is otherwise unreachable the collector clears it
+   from its bucket, and the bucket is dropped the next time its chain
+   is looked at.  A value that refers to its own key keeps it. */
+
+struct Scheme_Weak_Bucket
+{
+  void *key;			/* hidden from the collector */
+  void *val;
+  struct Scheme_Weak_Bucket *next;
+};
+typedef struct Scheme_Weak_Bucket Scheme_Weak_Bucket;
+
+struct Scheme_Weak_Table
+{
+  int size;
+  int count;			/* including buckets not yet dropped */
+  Scheme_Weak_Bucket **buckets;
+};
+typedef struct Scheme_Weak_Table Scheme_Weak_Table;
+
+/* A frame is one allocation: the values follow the header.  Its
+   symbols are usually a vector shared by every frame made for the
+   same lambda or binding form.  A frame that nothing can capture
+   may be on the frame stack instead of the collected heap; see
+   scheme_new_stack_frame(). */
+
 struct Scheme_Env
 {
   int num_bindings;
+  int stacked;			/* on the frame stack */
   struct Scheme_Object **symbols;
-  struct Scheme_Object **values;
-  Scheme_Hash_Table *globals;
   struct Scheme_Env *next;
+  struct Scheme_Object *values[1];	/* num_bindings of them */
 };
 typedef struct Scheme_Env Scheme_Env;
 
@@ -64,45 +92,95 @@ struct Scheme_Object
 {
   union
     {
-      char char_val;
-      int int_val;
       double double_val;
-      char *string_val;
+      struct { char *chars; int len; int size; } string_val; /* len of size used */
+      struct { char *name; struct Scheme_Object *global; } symbol_val;
+      struct { char *name; int layout; } type_val;
       void *ptr_val;
       struct { void *ptr1, *ptr2; } two_ptr_val;
       struct Scheme_Object *(*prim_val)
 	(int argc, struct Scheme_Object *argv[]);
-      struct Scheme_Object *(*syntax_val)
-	(struct Scheme_Object *form, struct Scheme_Env *env);
-      struct { struct Scheme_Object *car, *cdr; } pair_val;
-      struct { int size; struct Scheme_Object **els; } vector_val;
-      struct { struct Scheme_Env *env; struct Scheme_Object *code; } closure_val;
+      struct { struct Scheme_Object *(*proc)
+		 (struct Scheme_Object *form, struct Scheme_Env *env);
+	       struct Scheme_Node *(*analyzer)
+		 (struct Scheme_Object *form, struct Scheme_Env *env); } syntax_val;
+      struct { int size; } vector_val; /* elements follow the object */
+      struct { struct Scheme_Env *env; struct Scheme_Code *code; } closure_val;
       struct { struct Scheme_Object *def; struct Scheme_Method *meths; } methods_val;
     } u;
   struct Scheme_Object *type;
 };
 typedef struct Scheme_Object Scheme_Object;
 
+/* Tagged objects.  Integers, characters and the constants are
+   encoded in the object pointer itself, with no Scheme_Object behind
+   it, and a pair is a bare two-word cell with no type field.  The
+   low bits of a pointer say which it is:
+
+     ....1	an integer, in the bits above
+     ..010	a character, in the bits above
+     xx110	#f, #t, () or the eof object, for xx from 0 to 3
+     ..100	a pair, at the address 4 below
+     ..000	a pointer to a Scheme_Object
+
+   SCHEME_TYPE() takes the type of a tagged object from its low five
+   bits through scheme_tag_types.  _SCHEME_TYPE() is the type
+   field of a Scheme_Object, for setting when it is made, and
+   SCHEME_HEAP_TYPEP() tests for a type that has no tagged objects
+   without going through the table. */
+#define SCHEME_TAGGEDP(obj)  (((intptr_t) (obj)) & 7)
+#define SCHEME_FIXNUMP(obj)  (((intptr_t) (obj)) & 1)
+#define scheme_make_integer(i) ((Scheme_Object *) ((((intptr_t) (i)) << 1) | 1))
+#define scheme_make_char(ch) ((Scheme_Object *) ((((intptr_t) (unsigned char) (ch)) << 3) | 2))
+#define scheme_false         ((Scheme_Object *) 0x06)
+#define scheme_true          ((Scheme_Object *) 0x0e)
+#define scheme_null          ((Scheme_Object *) 0x16)
+#define scheme_eof           ((Scheme_Object *) 0x1e)
+extern struct Scheme_Object *scheme_tag_types[32];
+
 /* access macros */
-#define SCHEME_TYPE(obj)     ((obj)->type)
-#define SCHEME_CHAR_VAL(obj) ((obj)->u.char_val)
-#define SCHEME_INT_VAL(obj)  ((obj)->u.int_val)
+#define _SCHEME_TYPE(obj)    ((obj)->type)
+#define SCHEME_TYPE(obj)     (SCHEME_TAGGEDP (obj) \
+			      ? scheme_tag_types[((intptr_t) (obj)) & 31] \
+			      : _SCHEME_TYPE (obj))
+#define SCHEME_HEAP_TYPEP(obj, t) (! SCHEME_TAGGEDP (obj) && _SCHEME_TYPE (obj) == (t))
+#define SCHEME_CHAR_VAL(obj) ((char) (((intptr_t) (obj)) >> 3))
+#define SCHEME_INT_VAL(obj)  ((int) (((intptr_t) (obj)) >> 1))
 #define SCHEME_DBL_VAL(obj)  ((obj)->u.double_val)
-#define SCHEME_STR_VAL(obj)  ((obj)->u.string_val)
+#define SCHEME_STR_VAL(obj)  ((obj)->u.string_val.chars)
+#define SCHEME_STR_LEN(obj)  ((obj)->u.string_val.len)
+#define SCHEME_STR_SIZE(obj) ((obj)->u.string_val.size)
+#define SCHEME_SYM_GLOBAL(obj) ((obj)->u.symbol_val.global)
+#define SCHEME_TYPE_LAYOUT(obj) ((obj)->u.type_val.layout)
 #define SCHEME_PTR_VAL(obj)  ((obj)->u.ptr_val)
 #define SCHEME_PTR1_VAL(obj) ((obj)->u.two_ptr_val.ptr1)
 #define SCHEME_PTR2_VAL(obj) ((obj)->u.two_ptr_val.ptr2)
-#define SCHEME_SYNTAX(obj)   ((obj)->u.syntax_val)
+#define SCHEME_SYNTAX(obj)   ((obj)->u.syntax_val.proc)
+#define SCHEME_ANALYZER(obj) ((obj)->u.syntax_val.analyzer)
 #define SCHEME_PRIM(obj)     ((obj)->u.prim_val)
-#define SCHEME_CAR(obj)      ((obj)->u.pair_val.car)
-#define SCHEME_CDR(obj)      ((obj)->u.pair_val.cdr)
+#define SCHEME_PAIR_CELL(obj) ((Scheme_Object **) ((char *) (obj) - 4))
+#define SCHEME_CAR(obj)      (SCHEME_PAIR_CELL (obj)[0])
+#define SCHEME_CDR(obj)      (SCHEME_PAIR_CELL (obj)[1])
 #define SCHEME_VEC_SIZE(obj) ((obj)->u.vector_val.size)
-#define SCHEME_VEC_ELS(obj)  ((obj)->u.vector_val.els)
+#define SCHEME_VEC_ELS(obj)  ((Scheme_Object **) ((obj) + 1))
+#define SCHEME_NUMVEC_SIZE(obj) ((obj)->u.vector_val.size)
+#define SCHEME_U8VEC_ELS(obj) ((unsigned char *) ((obj) + 1))
+#define SCHEME_S32VEC_ELS(obj) ((int32_t *) ((obj) + 1))
+#define SCHEME_F64VEC_ELS(obj) ((double *) ((obj) + 1))
 #define SCHEME_CLOS_ENV(obj) ((obj)->u.closure_val.env)
 #define SCHEME_CLOS_CODE(obj)((obj)->u.closure_val.code)
 #define SCHEME_METH_DEF(obj) ((obj)->u.methods_val.def)
 #define SCHEME_METHS(obj)    ((obj)->u.methods_val.meths)
 
+/* Object layouts.  A type made by scheme_make_layout_type() says
+   which words of the union hold heap pointers, and the collector
+   scans only those and the type in objects from
+   scheme_alloc_typed_object(). */
+#define SCHEME_LAYOUT_NONE   0
+#define SCHEME_LAYOUT_PTR1   1	/* ptr_val, ptr1 */
+#define SCHEME_LAYOUT_PTR2   2	/* ptr2 */
+#define SCHEME_LAYOUT_ALL    3
+
 struct Scheme_Method
 {
   Scheme_Object *type;
@@ -117,6 +195,174 @@ typedef struct Scheme_Object *
 typedef struct Scheme_Object *
 (Scheme_Syntax) (struct Scheme_Object *form, struct Scheme_Env *env);
 
+/* analyzed code
+
+   Forms are converted once by scheme_analyze() into a tree of nodes,
+   which scheme_compile() turns into bytecode.  The fields a node uses
+   depend on its kind.  A lexical address counts `depth' frames
+   out from the current one and then `index' bindings into it:
+
+     CONST	obj = value
+     LOCAL	obj = symbol, depth/index = lexical address
+     GLOBAL	obj = symbol
+     LOCAL_SET	obj = symbol, depth/index = lexical address, a = value
+     SET	obj = symbol (a global), a = value
+     DEFINE	obj = symbol, a = value
+     IF		a = test, b = then, c = else (or NULL)
+     SEQ	nodes[num]
+     AND, OR	nodes[num]
+     APP	a = rator, nodes[num] = rands, obj = form
+     SYNTAX	a = rator, obj = form (syntax without an analyzer)
+     MACRO	a = rator, obj = form
+     LAMBDA	obj = parameter list, syms[num] = parameters,
+		flags = SCHEME_REST_PARAM if the last one takes the
+		rest of the args, a = body
+     LET	syms[num], nodes[num] = inits, a = body
+     LETREC	syms[num], nodes[num] = inits, a = body
+     NAMED_LET	syms[1] = name, nodes[num] = inits, a = lambda
+     COND	nodes[num] = clauses
+     CLAUSE	a = test (NULL for else), b = body (NULL for none),
+		flags = SCHEME_ARROW_CLAUSE for `=>' clauses
+     CASE	a = key, nodes[num] = clauses
+     CASE_CLAUSE obj = data (NULL for else), b = body
+     DO		syms[num], nodes[2*num] = inits and steps,
+		a = test, b = results, c = body
+     DELAY	a = expression
+     DEFMACRO	obj = symbol, a = lambda */
+
+enum
+{
+  SCHEME_CONST_NODE,
+  SCHEME_LOCAL_NODE,
+  SCHEME_GLOBAL_NODE,
+  SCHEME_LOCAL_SET_NODE,
+  SCHEME_SET_NODE,
+  SCHEME_DEFINE_NODE,
+  SCHEME_IF_NODE,
+  SCHEME_SEQ_NODE,
+  SCHEME_AND_NODE,
+  SCHEME_OR_NODE,
+  SCHEME_APP_NODE,
+  SCHEME_SYNTAX_NODE,
+  SCHEME_MACRO_NODE,
+  SCHEME_LAMBDA_NODE,
+  SCHEME_LET_NODE,
+  SCHEME_LETREC_NODE,
+  SCHEME_NAMED_LET_NODE,
+  SCHEME_COND_NODE,
+  SCHEME_CLAUSE_NODE,
+  SCHEME_CASE_NODE,
+  SCHEME_CASE_CLAUSE_NODE,
+  SCHEME_DO_NODE,
+  SCHEME_DELAY_NODE,
+  SCHEME_DEFMACRO_NODE
+};
+
+#define SCHEME_ARROW_CLAUSE 1
+#define SCHEME_REST_PARAM 1
+
+struct Scheme_Node
+{
+  int kind;
+  int flags;
+  int num;
+  int depth, index;
+  struct Scheme_Object *obj;
+  struct Scheme_Object **syms;
+  struct Scheme_Node *a, *b, *c;
+  struct Scheme_Node **nodes;
+};
+typedef struct Scheme_Node Scheme_Node;
+
+typedef struct Scheme_Node *
+(Scheme_Analyzer) (struct Scheme_Object *form, struct Scheme_Env *env);
+
+/* bytecode
+
+   Compiled code is an array of ints, each instruction an opcode
+   followed by its operands, run by scheme_execute() on an explicit
+   value stack.  k names an entry in the code's constant vector and
+   L is the index of an instruction in the same code.  A site is
+   three constants starting at k: a form, and the operator and code
+   its expansion was last compiled for.
+
+     CONST k		push consts[k]
+     LOCAL0 i		push binding i of the innermost frame
+     LOCAL d i		push binding i of the frame d frames out
+     GLOBAL k		push the global value of symbol consts[k]
+     SET_LOCAL d i	store top in binding i of frame d (top stays)
+     SET_GLOBAL k	store top in the global symbol consts[k]
+     DEFINE k		bind top to symbol consts[k], replace it with the symbol
+     POP		drop top
+     INSERT n		move top down below the n values under it
+     JUMP L		continue at L
+     JUMP_FALSE L	pop, continue at L if it was #f
+     JUMP_FALSE_KEEP L	continue at L if top is #f, else pop
+     JUMP_TRUE_KEEP L	continue at L if top is not #f, else pop
+     MEMV k L		continue at L unless top is eqv? to a member of consts[k]
+     PROC k L		if the operator on top is syntax or a macro, run
+			the form at site k instead and continue at L
+     CALL n		call the operator under n args, push its value
+     TAIL_CALL n	the same, replacing the current call
+     RETURN		return top to the caller
+     CLOSURE k		push a closure of the code consts[k]
+     FRAME n k s	pop n values into a new frame with symbols consts[k],
+			on the frame stack if s is nonzero
+     EMPTY_FRAME n k s	push a new frame of n #f bindings
+     REFRAME n k s	replace the innermost frame with one of n popped values
+     POP_FRAME		drop the innermost frame
+     SYNTAX k		run the form at site k, a use of syntax without an analyzer
+     MACRO k		expand and run the form at site k, a macro use
+     TAIL_MACRO k	the same, replacing the current call
+     DELAY k		push a promise of the code consts[k]
+     DEFMACRO k s	bind symbol consts[s] to a macro of the code consts[k] */
+
+enum
+{
+  SCHEME_CONST_OP,
+  SCHEME_LOCAL0_OP,
+  SCHEME_LOCAL_OP,
+  SCHEME_GLOBAL_OP,
+  SCHEME_SET_LOCAL_OP,
+  SCHEME_SET_GLOBAL_OP,
+  SCHEME_DEFINE_OP,
+  SCHEME_POP_OP,
+  SCHEME_INSERT_OP,
+  SCHEME_JUMP_OP,
+  SCHEME_JUMP_FALSE_OP,
+  SCHEME_JUMP_FALSE_KEEP_OP,
+  SCHEME_JUMP_TRUE_KEEP_OP,
+  SCHEME_MEMV_OP,
+  SCHEME_PROC_OP,
+  SCHEME_CALL_OP,
+  SCHEME_TAIL_CALL_OP,
+  SCHEME_RETURN_OP,
+  SCHEME_CLOSURE_OP,
+  SCHEME_FRAME_OP,
+  SCHEME_EMPTY_FRAME_OP,
+  SCHEME_REFRAME_OP,
+  SCHEME_POP_FRAME_OP,
+  SCHEME_SYNTAX_OP,
+  SCHEME_MACRO_OP,
+  SCHEME_TAIL_MACRO_OP,
+  SCHEME_DELAY_OP,
+  SCHEME_DEFMACRO_OP,
+  SCHEME_NUM_OPS
+};
+
+struct Scheme_Code
+{
+  int *ops;
+  struct Scheme_Object **consts;
+  int max_depth;		/* most stack slots the code uses */
+  /* for lambdas */
+  int num_params;		/* counting a rest parameter */
+  int rest;			/* last parameter takes the rest of the args */
+  struct Scheme_Object **param_syms;
+  int stacked;			/* its frames can go on the frame stack */
+};
+typedef struct Scheme_Code Scheme_Code;
+
 struct Scheme_Jmpbuf
 {
 	jmp_buf jmpbuf;
@@ -126,11 +372,18 @@ typedef struct Scheme_Jmpbuf Scheme_Jmpbuf[1];
 
 /* error handling */
 extern jmp_buf scheme_error_buf;
+extern Scheme_Object **scheme_stack_top, **scheme_stack_mark;
+extern Scheme_Object **scheme_stack_limit;
+extern char *scheme_frame_top, *scheme_frame_mark;
 void scheme_signal_error (char *msg, ...);
 void scheme_warning (char *msg, ...);
 void scheme_default_handler (void);
 #define SCHEME_CATCH_ERROR(try_expr, err_expr) \
-  (setjmp(scheme_error_buf) ? (err_expr) : (try_expr))
+  (scheme_stack_mark = scheme_stack_top, scheme_frame_mark = scheme_frame_top, \
+   setjmp(scheme_error_buf) \
+   ? (scheme_reset_stack (scheme_stack_mark), scheme_release_frames (scheme_frame_mark), \
+      (Scheme_Object *) (err_expr)) \
+   : (try_expr))
 #define SCHEME_ASSERT(expr,msg) \
   ((expr) ? 0 : (scheme_signal_error(msg), 1))
 
@@ -141,6 +394,8 @@ extern Scheme_Object *scheme_integer_type, *scheme_double_type;
 extern Scheme_Object *scheme_string_type, *scheme_symbol_type;
 extern Scheme_Object *scheme_null_type, *scheme_pair_type;
 extern Scheme_Object *scheme_vector_type;
+extern Scheme_Object *scheme_u8vector_type, *scheme_s32vector_type;
+extern Scheme_Object *scheme_f64vector_type;
 extern Scheme_Object *scheme_prim_type, *scheme_closure_type;
 extern Scheme_Object *scheme_cont_type;
 extern Scheme_Object *scheme_input_port_type, *scheme_output_port_type;
@@ -148,6 +403,7 @@ extern Scheme_Object *scheme_eof_type;
 extern Scheme_Object *scheme_true_type, *scheme_false_type;
 extern Scheme_Object *scheme_syntax_type, *scheme_macro_type;
 extern Scheme_Object *scheme_promise_type, *scheme_struct_proc_type;
+extern Scheme_Object *scheme_weak_box_type, *scheme_weak_table_type;
 
 /* common symbols */
 extern Scheme_Object *scheme_quote_symbol;
@@ -155,15 +411,14 @@ extern Scheme_Object *scheme_quasiquote_symbol;
 extern Scheme_Object *scheme_unquote_symbol;
 extern Scheme_Object *scheme_unquote_splicing_symbol;
 
-/* constants */
-extern Scheme_Object *scheme_eof;
-extern Scheme_Object *scheme_null;
-extern Scheme_Object *scheme_true;
-extern Scheme_Object *scheme_false;
-
 /* basics */
 Scheme_Object *scheme_read (Scheme_Object *port);
 Scheme_Object *scheme_eval (Scheme_Object *obj, Scheme_Env *env);
+Scheme_Node *scheme_analyze (Scheme_Object *obj, Scheme_Env *env);
+Scheme_Code *scheme_compile (Scheme_Node *node);
+Scheme_Object *scheme_execute (Scheme_Code *code, Scheme_Env *env);
+Scheme_Object **scheme_alloc_args (int n);
+void scheme_reset_stack (Scheme_Object **mark);
 void scheme_write (Scheme_Object *obj, Scheme_Object *port);
 void scheme_display (Scheme_Object *obj, Scheme_Object *port);
 void scheme_write_string (char *str, Scheme_Object *port);
@@ -173,37 +428,105 @@ void scheme_debug_print (Scheme_Object *obj);
 Scheme_Object *scheme_apply (Scheme_Object *rator, int num_rands, Scheme_Object **rands);
 Scheme_Object *scheme_apply_to_list (Scheme_Object *rator, Scheme_Object *rands);
 Scheme_Object *scheme_apply_struct_proc (Scheme_Object *rator, Scheme_Object *rands);
+Scheme_Env *scheme_closure_frame (Scheme_Object *closure, int num_rands, Scheme_Object **rands);
 Scheme_Object *scheme_alloc_object (void);
+Scheme_Object *scheme_alloc_atomic_object (void);
+Scheme_Object *scheme_alloc_typed_object (Scheme_Object *type);
 void *scheme_malloc (size_t size);
+void *scheme_malloc_atomic (size_t size);
+void *scheme_alloc_cell (void);
 void *scheme_realloc (void *old, size_t size);
 void *scheme_calloc (size_t num, size_t size);
 char *scheme_strdup (char *str);
+int scheme_weak_link (void **link, Scheme_Object *obj);
+void scheme_weak_unlink (void **link);
+void *scheme_weak_value (void **link);
+void scheme_register_finalizer (Scheme_Object *obj, void (*fn) (void *obj, void *data),
+				void *data);
+#define SCHEME_HIDE_POINTER(p) ((void *) ~(uintptr_t) (p))
+
+/* collector control */
+#define SCHEME_GC_PAUSE_BUCKETS 20
+
+struct Scheme_GC_Pause_Stats
+{
+  unsigned long count;		/* times the world was stopped */
+  unsigned long total_usecs;
+  unsigned long max_usecs;
+  /* histogram[i] counts the pauses shorter than 2^i microseconds
+     that no earlier bucket counts; the last takes all the rest */
+  unsigned long histogram[SCHEME_GC_PAUSE_BUCKETS];
+};
+typedef struct Scheme_GC_Pause_Stats Scheme_GC_Pause_Stats;
+
+struct Scheme_GC_Stats
+{
+  unsigned long collections;
+  unsigned long heap_bytes;
+  unsigned long free_bytes;	/* at least this many */
+  unsigned long bytes_since_gc;
+  unsigned long total_bytes;	/* allocated since startup */
+};
+typedef struct Scheme_GC_Stats Scheme_GC_Stats;
+
+int scheme_gc_markers (void);
+int scheme_set_gc_markers (int n);
+void scheme_gc_collect (void);
+int scheme_gc_incremental (void);
+int scheme_set_gc_incremental (unsigned long pause_msecs);
+void scheme_gc_pause_stats (Scheme_GC_Pause_Stats *stats, int reset);
+void scheme_gc_stats (Scheme_GC_Stats *stats);
+Scheme_Object *scheme_gc_census (void);
+Scheme_Object *scheme_heap_object_type (void *obj, size_t size, int kind);
 
 /* garbage collected heap interface */
 extern void *GC_malloc (size_t size_in_bytes);
+extern void *GC_malloc_atomic (size_t size_in_bytes);
 extern void *GC_realloc (void *old, size_t size_in_bytes);
-extern int GC_expand_hp (int num_4k_blocks);
+extern int GC_expand_hp (size_t number_of_bytes);
 
 /* hash table interface */
 Scheme_Hash_Table *scheme_hash_table (int size);
 void scheme_add_to_table (Scheme_Hash_Table *table, char *key, void *val);
 void scheme_change_in_table (Scheme_Hash_Table *table, char *key, void *new_val);
 void *scheme_lookup_in_table (Scheme_Hash_Table *table, char *key);
+Scheme_Weak_Table *scheme_weak_table (int size);
+void scheme_add_to_weak_table (Scheme_Weak_Table *table, Scheme_Object *key, void *val);
+void *scheme_lookup_in_weak_table (Scheme_Weak_Table *table, Scheme_Object *key);
+void scheme_remove_from_weak_table (Scheme_Weak_Table *table, Scheme_Object *key);
+int scheme_weak_table_count (Scheme_Weak_Table *table);
 
 /* constructors */
 Scheme_Object *scheme_make_prim (Scheme_Prim *prim);
-Scheme_Object *scheme_make_closure (Scheme_Env *env, Scheme_Object *code);
+Scheme_Object *scheme_make_closure (Scheme_Env *env, Scheme_Code *code);
 Scheme_Object *scheme_make_cont (Scheme_Jmpbuf sbuf);
 Scheme_Object *scheme_make_type (char *name);
+Scheme_Object *scheme_make_layout_type (char *name, int layout);
+void scheme_set_tag_type (Scheme_Object *obj, int bits, Scheme_Object *type);
 Scheme_Object *scheme_make_pair (Scheme_Object *car, Scheme_Object *cdr);
 Scheme_Object *scheme_make_string (char *chars);
+Scheme_Object *scheme_make_sized_string (char *chars, int len);
 Scheme_Object *scheme_alloc_string (int size, char fill);
 Scheme_Object *scheme_make_vector (int size, Scheme_Object *fill);
-Scheme_Object *scheme_make_integer (int i);
+Scheme_Object *scheme_alloc_vector (Scheme_Object *type, int size);
+Scheme_Object *scheme_alloc_numvec (Scheme_Object *type, int size, int el_size);
+void scheme_numvec_range (char *name, Scheme_Object *vec, int argc,
+			  Scheme_Object *argv[], int first, int *start, int *end);
 Scheme_Object *scheme_make_double (double d);
-Scheme_Object *scheme_make_char (char ch);
 Scheme_Object *scheme_make_syntax (Scheme_Syntax *syntax);
+Scheme_Object *scheme_make_syntax_analyzer (Scheme_Analyzer *analyzer);
 Scheme_Object *scheme_make_promise (Scheme_Object *expr, Scheme_Env *env);
+Scheme_Object *scheme_make_code_promise (Scheme_Code *code, Scheme_Env *env);
+Scheme_Object *scheme_make_weak_box (Scheme_Object *val);
+Scheme_Object *scheme_weak_box_value (Scheme_Object *box);
+Scheme_Object *scheme_make_weak_hash_table (int size);
+
+/* analyzer support */
+Scheme_Node *scheme_make_node (int kind);
+Scheme_Node *scheme_make_const_node (Scheme_Object *obj);
+Scheme_Node **scheme_analyze_list (Scheme_Object *forms, int num, Scheme_Env *env);
+Scheme_Env *scheme_new_scope (int num_bindings, Scheme_Object **syms, Scheme_Env *env);
+int scheme_lexical_address (Scheme_Object *symbol, Scheme_Env *env, int *depth, int *index);
 
 /* generic port support */
 
@@ -218,11 +541,17 @@ struct Scheme_Input_Port
 };
 typedef struct Scheme_Input_Port Scheme_Input_Port;
 
+/* write_string_fun is passed the length of the string to write,
+   which may hold NULs.  This is an incompatible change: it used to
+   be (char *str, Scheme_Output_Port *port) and was given a
+   NUL-terminated string, so port types defined outside this library
+   must take the len argument and write exactly that many chars. */
+
 struct Scheme_Output_Port
 {
   Scheme_Object *sub_type;
   void *port_data;
-  void (*write_string_fun) (char *str, struct Scheme_Output_Port *);
+  void (*write_string_fun) (char *str, int len, struct Scheme_Output_Port *);
   void (*close_fun) (struct Scheme_Output_Port *);
 };
 typedef struct Scheme_Output_Port Scheme_Output_Port;
@@ -246,11 +575,11 @@ Scheme_Output_Port *
 scheme_make_output_port (
   Scheme_Object *subtype,
   void *data,
-  void (*write_string_fun) (char *str, Scheme_Output_Port*),
+  void (*write_string_fun) (char *str, int len, Scheme_Output_Port*),
   void (*close_fun) (Scheme_Output_Port*)
 );
 Scheme_Object *scheme_make_file_input_port (FILE *fp);
-Scheme_Object *scheme_make_string_input_port (char *str);
+Scheme_Object *scheme_make_string_input_port (char *str, int len);
 Scheme_Object *scheme_make_file_output_port (FILE *fp);
 Scheme_Object *scheme_make_string_output_port (char *str);
 extern Scheme_Object *scheme_stdin_port;
@@ -259,7 +588,10 @@ extern Scheme_Object *scheme_stderr_port;
 
 /* environment */
 void scheme_add_global (char *name, Scheme_Object *val, Scheme_Env *env);
-Scheme_Env *scheme_new_frame (int num_bindings);
+Scheme_Env *scheme_new_frame (int num_bindings, Scheme_Object **symbols);
+Scheme_Env *scheme_new_stack_frame (int num_bindings, Scheme_Object **symbols);
+void scheme_release_frames (char *mark);
+void scheme_capture_env (Scheme_Env *env);
 void scheme_add_binding (int index, Scheme_Object *sym, Scheme_Object *val, Scheme_Env *frame);
 Scheme_Env *scheme_extend_env (Scheme_Env *frame, Scheme_Env *env);
 Scheme_Env *scheme_add_frame (Scheme_Object *syms, Scheme_Object *vals, Scheme_Env *env);
@@ -267,6 +599,7 @@ Scheme_Env *scheme_pop_frame (Scheme_Env *env);
 void scheme_set_value (Scheme_Object *var, Scheme_Object *val, Scheme_Env *env);
 Scheme_Object *scheme_lookup_value (Scheme_Object *symbol, Scheme_Env *env);
 Scheme_Object *scheme_lookup_global (Scheme_Object *symbol, Scheme_Env *env);
+void scheme_set_global (Scheme_Object *symbol, Scheme_Object *val, Scheme_Env *env);
 extern Scheme_Env *scheme_env;
 
 /* symbols */
@@ -274,16 +607,20 @@ Scheme_Object *scheme_intern_symbol (char *name);
 
 /* initialization */
 Scheme_Env *scheme_basic_env (void);
+void scheme_init_alloc (void);
 void scheme_init_type (Scheme_Env *env);
 void scheme_init_list (Scheme_Env *env);
 void scheme_init_port (Scheme_Env *env);
 void scheme_init_proc (Scheme_Env *env);
 void scheme_init_vector (Scheme_Env *env);
+void scheme_init_numvec (Scheme_Env *env);
 void scheme_init_string (Scheme_Env *env);
 void scheme_init_number (Scheme_Env *env);
 void scheme_init_eval (Scheme_Env *env);
 void scheme_init_promise (Scheme_Env *env);
 void scheme_init_struct (Scheme_Env *env);
+void scheme_init_gc (Scheme_Env *env);
+void scheme_init_weak (Scheme_Env *env);
 
 /* misc */
 int scheme_eq (Scheme_Object *obj1, Scheme_Object *obj2);
@@ -300,34 +637,36 @@ Scheme_Object *scheme_vector_to_list (Scheme_Object *vec);
 Scheme_Object *scheme_list_to_vector (Scheme_Object *list);
 
 /* convenience macros */
-#define SCHEME_CHARP(obj)    (SCHEME_TYPE(obj) == scheme_char_type)
-#define SCHEME_INTP(obj)     (SCHEME_TYPE(obj) == scheme_integer_type)
-#define SCHEME_DBLP(obj)     (SCHEME_TYPE(obj) == scheme_double_type)
+#define SCHEME_CHARP(obj)    ((((intptr_t) (obj)) & 7) == 2)
+#define SCHEME_INTP(obj)     (SCHEME_FIXNUMP(obj))
+#define SCHEME_DBLP(obj)     (SCHEME_HEAP_TYPEP(obj, scheme_double_type))
 #define SCHEME_NUMBERP(obj)  (SCHEME_INTP(obj) || SCHEME_DBLP(obj))
-#define SCHEME_STRINGP(obj)  (SCHEME_TYPE(obj) == scheme_string_type)
-#define SCHEME_SYMBOLP(obj)  (SCHEME_TYPE(obj) == scheme_symbol_type)
-#define SCHEME_BOOLP(obj)    ((obj == scheme_true) || (obj == scheme_false))
-#define SCHEME_SYNTAXP(obj)  (SCHEME_TYPE(obj) == scheme_syntax_type)
-#define SCHEME_PRIMP(obj)    (SCHEME_TYPE(obj) == scheme_prim_type)
-#define SCHEME_CONTP(obj)    (SCHEME_TYPE(obj) == scheme_cont_type)
+#define SCHEME_STRINGP(obj)  (SCHEME_HEAP_TYPEP(obj, scheme_string_type))
+#define SCHEME_SYMBOLP(obj)  (SCHEME_HEAP_TYPEP(obj, scheme_symbol_type))
+#define SCHEME_BOOLP(obj)    ((((intptr_t) (obj)) & ~(intptr_t) 8) == 6)
+#define SCHEME_SYNTAXP(obj)  (SCHEME_HEAP_TYPEP(obj, scheme_syntax_type))
+#define SCHEME_PRIMP(obj)    (SCHEME_HEAP_TYPEP(obj, scheme_prim_type))
+#define SCHEME_CONTP(obj)    (SCHEME_HEAP_TYPEP(obj, scheme_cont_type))
 #define SCHEME_NULLP(obj)    (obj == scheme_null)
-#define SCHEME_PAIRP(obj)    (SCHEME_TYPE(obj) == scheme_pair_type)
+#define SCHEME_PAIRP(obj)    ((((intptr_t) (obj)) & 7) == 4)
 #define SCHEME_LISTP(obj)    (SCHEME_NULLP(obj) || SCHEME_PAIRP(obj))
-#define SCHEME_VECTORP(obj)  (SCHEME_TYPE(obj) == scheme_vector_type)
-#define SCHEME_CLOSUREP(obj) (SCHEME_TYPE(obj) == scheme_closure_type)
+#define SCHEME_VECTORP(obj)  (SCHEME_HEAP_TYPEP(obj, scheme_vector_type))
+#define SCHEME_U8VECTORP(obj) (SCHEME_HEAP_TYPEP(obj, scheme_u8vector_type))
+#define SCHEME_S32VECTORP(obj) (SCHEME_HEAP_TYPEP(obj, scheme_s32vector_type))
+#define SCHEME_F64VECTORP(obj) (SCHEME_HEAP_TYPEP(obj, scheme_f64vector_type))
+#define SCHEME_CLOSUREP(obj) (SCHEME_HEAP_TYPEP(obj, scheme_closure_type))
 #define SCHEME_PROCP(obj)    (SCHEME_PRIMP(obj) || SCHEME_CLOSUREP(obj) || SCHEME_CONTP(obj))
-#define SCHEME_INPORTP(obj)  (SCHEME_TYPE(obj) == scheme_input_port_type)
-#define SCHEME_OUTPORTP(obj) (SCHEME_TYPE(obj) == scheme_output_port_type)
-#define SCHEME_EOFP(obj)     (SCHEME_TYPE(obj) == scheme_eof_type)
-#define SCHEME_PROMP(obj)    (SCHEME_TYPE(obj) == scheme_promise_type)
+#define SCHEME_INPORTP(obj)  (SCHEME_HEAP_TYPEP(obj, scheme_input_port_type))
+#define SCHEME_OUTPORTP(obj) (SCHEME_HEAP_TYPEP(obj, scheme_output_port_type))
+#define SCHEME_EOFP(obj)     ((obj) == scheme_eof)
+#define SCHEME_PROMP(obj)    (SCHEME_HEAP_TYPEP(obj, scheme_promise_type))
+#define SCHEME_WEAK_BOXP(obj) (SCHEME_HEAP_TYPEP(obj, scheme_weak_box_type))
+#define SCHEME_WEAK_TABLEP(obj) (SCHEME_HEAP_TYPEP(obj, scheme_weak_table_type))
 /* other */
 #define SCHEME_CADR(obj)     (SCHEME_CAR (SCHEME_CDR (obj)))
 #define SCHEME_CAAR(obj)     (SCHEME_CAR (SCHEME_CAR (obj)))
 #define SCHEME_CDDR(obj)     (SCHEME_CDR (SCHEME_CDR (obj)))
 
-/* constants */
-#define SCHEME_MAX_ARGS 256	/* max number of args to function */
-
 #ifdef __cplusplus
 }
 #endif
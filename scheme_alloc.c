@@ -23,16 +23,97 @@
 */
 
 #include "scheme.h"
+#include <stddef.h>
 #include <string.h>
+#ifdef THREAD_LOCAL_ALLOC
+#include <pthread.h>
+#endif
 
 #ifdef NO_GC
+#undef THREAD_LOCAL_ALLOC
 #define MALLOC malloc
+#define MALLOC_ATOMIC malloc
 #define REALLOC realloc
+#elif defined (THREAD_LOCAL_ALLOC)
+#define MALLOC GC_local_malloc
+#define MALLOC_ATOMIC GC_local_malloc_atomic
+#define REALLOC GC_realloc
 #else
 #define MALLOC GC_malloc
+#define MALLOC_ATOMIC GC_malloc_atomic
 #define REALLOC GC_realloc
 #endif
 
+#ifndef NO_GC
+/* From the collector's gc.h, gc_mark.h, gc_typed.h and
+   gc_local_alloc.h, except GC_generic_malloc_many(), which none of
+   them declares. */
+extern void GC_init (void);
+extern unsigned long GC_make_descriptor (unsigned long *bitmap, size_t len);
+extern void **GC_new_free_list (void);
+extern int GC_new_kind (void **free_list, size_t descriptor,
+			int add_size_to_descriptor, int clear_new_objects);
+extern char *GC_generic_malloc (size_t size_in_bytes, int kind);
+extern void *GC_base (void *displaced_pointer);
+extern int GC_general_register_disappearing_link (void **link, void *obj);
+extern int GC_unregister_disappearing_link (void **link);
+extern void *GC_call_with_alloc_lock (void *(*fn) (void *), void *client_data);
+extern void GC_register_finalizer (void *obj, void (*fn) (void *obj, void *client_data),
+				   void *client_data,
+				   void (**old_fn) (void *obj, void *client_data),
+				   void **old_client_data);
+#ifdef THREAD_LOCAL_ALLOC
+extern void *GC_local_malloc (size_t size_in_bytes);
+extern void *GC_local_malloc_atomic (size_t size_in_bytes);
+extern void GC_generic_malloc_many (size_t size_in_bytes, int kind, void **result);
+extern void *GC_malloc_uncollectable (size_t size_in_bytes);
+extern void GC_free (void *ptr);
+#endif
+#endif
+
+#define CELL_SIZE (2 * sizeof (void *) - 1)
+
+/* The collector's own kinds, from gc_priv.h. */
+#define GC_PTRFREE_KIND 0
+#define GC_NORMAL_KIND 1
+
+#ifndef NO_GC
+static int cell_kind;
+static int layout_kinds[SCHEME_LAYOUT_ALL + 1];
+static int make_layout_kind (int layout);
+static void *read_link (void *link);
+#endif
+#ifdef THREAD_LOCAL_ALLOC
+static pthread_key_t cell_key;
+static void free_cell_list (void *list);
+#endif
+
+/* The collector has to be set up before the first thread-local
+   allocation, which finds its free lists through it, and the kinds
+   are all made here, before there are other threads to race for
+   them. */
+
+void
+scheme_init_alloc (void)
+{
+#ifndef NO_GC
+  int layout;
+
+  GC_init ();
+  cell_kind = GC_new_kind (GC_new_free_list (), 0, 1, 1);
+  for ( layout=0 ; layout<=SCHEME_LAYOUT_ALL ; ++layout )
+    {
+      layout_kinds[layout] = make_layout_kind (layout);
+    }
+#endif
+#ifdef THREAD_LOCAL_ALLOC
+  pthread_key_create (&cell_key, free_cell_list);
+  /* GC_generic_malloc_many() expects the kind's reclaim lists, which
+     only a first GC_generic_malloc() sets up. */
+  GC_generic_malloc (CELL_SIZE, cell_kind);
+#endif
+}
+
 Scheme_Object *
 scheme_alloc_object (void)
 {
@@ -42,6 +123,59 @@ scheme_alloc_object (void)
   return (object);
 }
 
+/* An object whose only pointer is its type, such as a double.  Type
+   objects are all held by globals, so the collector loses nothing by
+   not scanning it. */
+
+Scheme_Object *
+scheme_alloc_atomic_object (void)
+{
+  Scheme_Object *object;
+
+  object = (Scheme_Object *) scheme_malloc_atomic (sizeof (Scheme_Object));
+  return (object);
+}
+
+/* An object of a type with a layout.  Each layout gets a kind of its
+   own in the collector, whose descriptor marks just the type and the
+   words of the layout, so an object costs no more than one from
+   scheme_alloc_object(). */
+
+#ifndef NO_GC
+static int
+make_layout_kind (int layout)
+{
+  unsigned long bitmap;
+
+  bitmap = (unsigned long) 1 << (offsetof (Scheme_Object, type) / sizeof (void *));
+  if (layout & SCHEME_LAYOUT_PTR1)
+    bitmap |= (unsigned long) 1
+      << (offsetof (Scheme_Object, u.two_ptr_val.ptr1) / sizeof (void *));
+  if (layout & SCHEME_LAYOUT_PTR2)
+    bitmap |= (unsigned long) 1
+      << (offsetof (Scheme_Object, u.two_ptr_val.ptr2) / sizeof (void *));
+  return (GC_new_kind (GC_new_free_list (),
+		       GC_make_descriptor (&bitmap, sizeof (Scheme_Object) / sizeof (void *)),
+		       0, 1));
+}
+#endif
+
+Scheme_Object *
+scheme_alloc_typed_object (Scheme_Object *type)
+{
+  Scheme_Object *object;
+
+#ifdef NO_GC
+  object = (Scheme_Object *) MALLOC (sizeof (Scheme_Object));
+#else
+  object = (Scheme_Object *) GC_generic_malloc (sizeof (Scheme_Object),
+						layout_kinds[SCHEME_TYPE_LAYOUT (type)]);
+#endif
+  SCHEME_ASSERT ((object != 0), "memory allocation failure");
+  _SCHEME_TYPE (object) = type;
+  return (object);
+}
+
 void *
 scheme_malloc (size_t size)
 {
@@ -52,6 +186,127 @@ scheme_malloc (size_t size)
   return (space);
 }
 
+/* For blocks that hold no pointers, which the collector need not
+   scan.  They are not cleared. */
+
+void *
+scheme_malloc_atomic (size_t size)
+{
+  void *space;
+
+  space = MALLOC_ATOMIC (size);
+  SCHEME_ASSERT ((space != 0), "memory allocation failure");
+  return (space);
+}
+
+/* A two-word cell, for a pair.  The collector takes pointers into
+   the middle of an object, and so normally adds a byte to each one
+   for a pointer just past its end to count too, which would put a
+   cell in the three-word size class.  The tagged pointers to pairs
+   are inside their cells anyway, so cells get a kind of their own
+   whose objects are scanned to their full length, and ask for a byte
+   less than two words.
+
+   The collector's thread-local free lists are only for its own
+   kinds, so with THREAD_LOCAL_ALLOC each thread keeps a list of free
+   cells here, refilled a block at a time.  The list head lives in an
+   uncollectable block, which the collector scans, and the cells are
+   linked through their first words, so it keeps the whole list. */
+
+#ifdef THREAD_LOCAL_ALLOC
+static __thread void **cell_list;
+
+static void
+free_cell_list (void *list)
+{
+  *(void **) list = 0;
+  GC_free (list);
+}
+
+static void *
+refill_cells (void)
+{
+  void *cell;
+
+  if (! cell_list)
+    {
+      cell_list = (void **) GC_malloc_uncollectable (sizeof (void *));
+      SCHEME_ASSERT ((cell_list != 0), "memory allocation failure");
+      pthread_setspecific (cell_key, cell_list);
+    }
+  GC_generic_malloc_many (CELL_SIZE, cell_kind, cell_list);
+  cell = *cell_list;
+  SCHEME_ASSERT ((cell != 0), "memory allocation failure");
+  *cell_list = *(void **) cell;
+  return (cell);
+}
+#endif
+
+void *
+scheme_alloc_cell (void)
+{
+  void *space;
+
+#ifdef NO_GC
+  space = MALLOC (2 * sizeof (void *));
+#elif defined (THREAD_LOCAL_ALLOC)
+  if (cell_list && (space = *cell_list))
+    {
+      *cell_list = *(void **) space;
+      ((void **) space)[0] = 0;
+      return (space);
+    }
+  space = refill_cells ();
+  ((void **) space)[0] = 0;
+#else
+  space = GC_generic_malloc (CELL_SIZE, cell_kind);
+#endif
+  SCHEME_ASSERT ((space != 0), "memory allocation failure");
+  return (space);
+}
+
+/* The type of the object at obj, one of the collector's of the given
+   kind and size, or NULL if it is not a Scheme object; for censuses
+   of the heap.  Blocks from scheme_malloc() are told from objects by
+   their third word, which for an object is its type, a heap object
+   whose own type is <type>.  Data can look like an object and fool
+   this, but no object is missed. */
+
+#ifndef NO_GC
+Scheme_Object *
+scheme_heap_object_type (void *obj, size_t size, int kind)
+{
+  Scheme_Object *type;
+  int layout;
+
+  if (kind == cell_kind)
+    {
+      return (scheme_pair_type);
+    }
+  for ( layout=0 ; layout<=SCHEME_LAYOUT_ALL ; ++layout )
+    {
+      if (kind == layout_kinds[layout])
+	{
+	  return (_SCHEME_TYPE ((Scheme_Object *) obj));
+	}
+    }
+  if ((kind != GC_NORMAL_KIND && kind != GC_PTRFREE_KIND)
+      || size < sizeof (Scheme_Object))
+    {
+      return (NULL);
+    }
+  type = _SCHEME_TYPE ((Scheme_Object *) obj);
+  if (type == NULL
+      || ((intptr_t) type & (sizeof (void *) - 1))
+      || GC_base (type) != (void *) type
+      || _SCHEME_TYPE (type) != scheme_type_type)
+    {
+      return (NULL);
+    }
+  return (type);
+}
+#endif
+
 void *
 scheme_calloc (size_t num, size_t size)
 {
@@ -78,7 +333,79 @@ scheme_strdup (char *str)
 {
   char *new;
 
-  new = scheme_malloc ((strlen (str) + 1) * sizeof (char));
+  new = scheme_malloc_atomic ((strlen (str) + 1) * sizeof (char));
   strcpy (new, str);
   return (new);
 }
+
+/* Weak references.  The collector clears *link once the heap block
+   that obj is in is only reachable through such links, so *link must
+   be in a word the collector does not scan: one outside the layout
+   of the object that holds it, or one holding the pointer hidden
+   with SCHEME_HIDE_POINTER().  Returns 0 if obj is not in the
+   collected heap, as for a fixnum, and will never be cleared. */
+
+int
+scheme_weak_link (void **link, Scheme_Object *obj)
+{
+#ifndef NO_GC
+  void *base;
+
+  base = GC_base ((void *) obj);
+  if (! base)
+    {
+      return (0);
+    }
+  SCHEME_ASSERT ((GC_general_register_disappearing_link (link, base) != 2),
+		 "memory allocation failure");
+  return (1);
+#else
+  return (0);
+#endif
+}
+
+void
+scheme_weak_unlink (void **link)
+{
+#ifndef NO_GC
+  GC_unregister_disappearing_link (link);
+#endif
+}
+
+/* What *link holds, read with the collector's lock held, so that
+   the collector cannot be about to clear it while the value it
+   returns is not yet anywhere that it scans. */
+
+void *
+scheme_weak_value (void **link)
+{
+#ifndef NO_GC
+  return (GC_call_with_alloc_lock (read_link, link));
+#else
+  return (*link);
+#endif
+}
+
+#ifndef NO_GC
+static void *
+read_link (void *link)
+{
+  return (*(void **) link);
+}
+#endif
+
+/* Has fn called on obj, with data, once obj is unreachable, so that
+   it can release what obj holds outside the collected heap, such as
+   a FILE.  obj must be the start of its block, so not a pair.  The
+   collector runs finalizers from inside later allocations, so fn
+   should only release resources, and must not block.  Registering
+   another fn for obj replaces the first. */
+
+void
+scheme_register_finalizer (Scheme_Object *obj, void (*fn) (void *obj, void *data),
+			   void *data)
+{
+#ifndef NO_GC
+  GC_register_finalizer ((void *) obj, fn, data, NULL, NULL);
+#endif
+}
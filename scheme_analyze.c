@@ -0,0 +1,177 @@
+/*
+  libscheme
+  Copyright (c) 1994 Brent Benson
+  All rights reserved.
+
+  Permission is hereby granted, without written agreement and without
+  license or royalty fees, to use, copy, modify, and distribute this
+  software and its documentation for any purpose, provided that the
+  above copyright notice and the following two paragraphs appear in
+  all copies of this software.
+
+  IN NO EVENT SHALL BRENT BENSON BE LIABLE TO ANY PARTY FOR DIRECT,
+  INDIRECT, SPECIAL, INCIDENTAL, OR CONSEQUENTIAL DAMAGES ARISING OUT
+  OF THE USE OF THIS SOFTWARE AND ITS DOCUMENTATION, EVEN IF BRENT
+  BENSON HAS BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+  BRENT BENSON SPECIFICALLY DISCLAIMS ANY WARRANTIES, INCLUDING, BUT
+  NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+  FITNESS FOR A PARTICULAR PURPOSE.  THE SOFTWARE PROVIDED HEREUNDER
+  IS ON AN "AS IS" BASIS, AND BRENT BENSON HAS NO OBLIGATION TO
+  PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR
+  MODIFICATIONS.
+*/
+
+#include "scheme.h"
+
+/* locals */
+static Scheme_Node *analyze_combination (Scheme_Object *form, Scheme_Env *env);
+
+Scheme_Node *
+scheme_analyze (Scheme_Object *obj, Scheme_Env *env)
+{
+  Scheme_Object *type;
+  Scheme_Node *node;
+
+  type = SCHEME_TYPE (obj);
+  if (type == scheme_symbol_type)
+    {
+      node = scheme_make_node (SCHEME_GLOBAL_NODE);
+      if (scheme_lexical_address (obj, env, &node->depth, &node->index))
+	{
+	  node->kind = SCHEME_LOCAL_NODE;
+	}
+      node->obj = obj;
+      return (node);
+    }
+  else if (type == scheme_pair_type)
+    {
+      return (analyze_combination (obj, env));
+    }
+  else
+    {
+      return (scheme_make_const_node (obj));
+    }
+}
+
+Scheme_Node *
+scheme_make_node (int kind)
+{
+  Scheme_Node *node;
+
+  node = (Scheme_Node *) scheme_malloc (sizeof (Scheme_Node));
+  node->kind = kind;
+  node->flags = 0;
+  node->num = 0;
+  node->depth = node->index = 0;
+  node->obj = NULL;
+  node->syms = NULL;
+  node->a = node->b = node->c = NULL;
+  node->nodes = NULL;
+  return (node);
+}
+
+Scheme_Node *
+scheme_make_const_node (Scheme_Object *obj)
+{
+  Scheme_Node *node;
+
+  node = scheme_make_node (SCHEME_CONST_NODE);
+  node->obj = obj;
+  return (node);
+}
+
+Scheme_Node **
+scheme_analyze_list (Scheme_Object *forms, int num, Scheme_Env *env)
+{
+  Scheme_Node **nodes;
+  int i;
+
+  nodes = (Scheme_Node **) scheme_malloc ((num ? num : 1) * sizeof (Scheme_Node *));
+  for ( i=0 ; i<num ; ++i )
+    {
+      SCHEME_ASSERT (SCHEME_PAIRP (forms), "bad syntax: improper list of forms");
+      nodes[i] = scheme_analyze (SCHEME_CAR (forms), env);
+      forms = SCHEME_CDR (forms);
+    }
+  return (nodes);
+}
+
+/* A scope is a frame that only records the symbols it binds.  The
+   analyzer builds one wherever scheme_execute() will push a frame,
+   so a variable's position among the scopes is also where its value
+   lives at run time. */
+
+Scheme_Env *
+scheme_new_scope (int num_bindings, Scheme_Object **syms, Scheme_Env *env)
+{
+  Scheme_Env *scope;
+
+  scope = (Scheme_Env *) scheme_malloc (sizeof (Scheme_Env));
+  scope->num_bindings = num_bindings;
+  scope->symbols = syms;
+  return (scheme_extend_env (scope, env));
+}
+
+int
+scheme_lexical_address (Scheme_Object *symbol, Scheme_Env *env, int *depth, int *index)
+{
+  Scheme_Env *frame;
+  int d, i;
+
+  for ( frame=env, d=0 ; frame->next != NULL ; frame=frame->next, ++d )
+    {
+      for ( i=0 ; i<frame->num_bindings ; ++i )
+	{
+	  if (symbol == frame->symbols[i])
+	    {
+	      *depth = d;
+	      *index = i;
+	      return (1);
+	    }
+	}
+    }
+  return (0);
+}
+
+/* local functions */
+
+static Scheme_Node *
+analyze_combination (Scheme_Object *form, Scheme_Env *env)
+{
+  Scheme_Object *rator, *val;
+  Scheme_Node *node;
+  int num_rands, depth, index;
+
+  rator = SCHEME_CAR (form);
+  if (SCHEME_SYMBOLP (rator) && ! scheme_lexical_address (rator, env, &depth, &index))
+    {
+      val = scheme_lookup_global (rator, env);
+      if (val && SCHEME_SYNTAXP (val))
+	{
+	  if (SCHEME_ANALYZER (val))
+	    {
+	      return (SCHEME_ANALYZER (val) (form, env));
+	    }
+	  node = scheme_make_node (SCHEME_SYNTAX_NODE);
+	  node->a = scheme_analyze (rator, env);
+	  node->obj = form;
+	  return (node);
+	}
+      if (val && SCHEME_TYPE (val) == scheme_macro_type)
+	{
+	  node = scheme_make_node (SCHEME_MACRO_NODE);
+	  node->a = scheme_analyze (rator, env);
+	  node->obj = form;
+	  return (node);
+	}
+    }
+
+  num_rands = scheme_list_length (SCHEME_CDR (form));
+  node = scheme_make_node (SCHEME_APP_NODE);
+  node->a = scheme_analyze (rator, env);
+  node->num = num_rands;
+  node->nodes = scheme_analyze_list (SCHEME_CDR (form), num_rands, env);
+  node->obj = form;
+  return (node);
+}
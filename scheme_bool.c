@@ -26,14 +26,10 @@
 #include <string.h>
 
 /* globals */
-Scheme_Object *scheme_true;
-Scheme_Object *scheme_false;
 Scheme_Object *scheme_true_type;
 Scheme_Object *scheme_false_type;
 
 /* locals */
-static Scheme_Object *scheme_make_true (void);
-static Scheme_Object *scheme_make_false (void);
 static Scheme_Object *not_prim (int argc, Scheme_Object *argv[]);
 static Scheme_Object *boolean_p_prim (int argc, Scheme_Object *argv[]);
 static Scheme_Object *eq_prim (int argc, Scheme_Object *argv[]);
@@ -42,6 +38,7 @@ static Scheme_Object *equal_prim (int argc, Scheme_Object *argv[]);
 
 static int list_equal (Scheme_Object *lst1, Scheme_Object *lst2);
 static int vector_equal (Scheme_Object *vec1, Scheme_Object *vec2);
+static int numvec_equal (Scheme_Object *vec1, Scheme_Object *vec2, int el_size);
 
 void
 scheme_init_bool (Scheme_Env *env)
@@ -50,8 +47,8 @@ scheme_init_bool (Scheme_Env *env)
   scheme_false_type = scheme_make_type ("<false>");
   scheme_add_global ("<true>", scheme_true_type, env);
   scheme_add_global ("<false>", scheme_false_type, env);
-  scheme_true = scheme_make_true ();
-  scheme_false = scheme_make_false ();
+  scheme_set_tag_type (scheme_true, 5, scheme_true_type);
+  scheme_set_tag_type (scheme_false, 5, scheme_false_type);
   scheme_add_global ("not", scheme_make_prim (not_prim), env);
   scheme_add_global ("boolean?", scheme_make_prim (boolean_p_prim), env);
   scheme_add_global ("eq?", scheme_make_prim (eq_prim), env);
@@ -59,26 +56,6 @@ scheme_init_bool (Scheme_Env *env)
   scheme_add_global ("equal?", scheme_make_prim (equal_prim), env);
 }
 
-static Scheme_Object *
-scheme_make_true (void)
-{
-  Scheme_Object *true;
-
-  true = scheme_alloc_object ();
-  SCHEME_TYPE (true) = scheme_true_type;
-  return (true);
-}
-
-static Scheme_Object *
-scheme_make_false (void)
-{
-  Scheme_Object *false;
-
-  false = scheme_alloc_object ();
-  SCHEME_TYPE (false) = scheme_false_type;
-  return (false);
-}
-
 static Scheme_Object *
 not_prim (int argc, Scheme_Object *argv[])
 {
@@ -215,8 +192,25 @@ scheme_equal (Scheme_Object *obj1, Scheme_Object *obj2)
     {
       return 1;
     }
+  else if (SCHEME_TYPE(obj1) == scheme_u8vector_type &&
+	   numvec_equal(obj1, obj2, sizeof (unsigned char)))
+    {
+      return 1;
+    }
+  else if (SCHEME_TYPE(obj1) == scheme_s32vector_type &&
+	   numvec_equal(obj1, obj2, sizeof (int32_t)))
+    {
+      return 1;
+    }
+  else if (SCHEME_TYPE(obj1) == scheme_f64vector_type &&
+	   numvec_equal(obj1, obj2, sizeof (double)))
+    {
+      return 1;
+    }
   else if (SCHEME_TYPE(obj1) == scheme_string_type &&
-	   (strcmp(SCHEME_STR_VAL(obj1), SCHEME_STR_VAL(obj2)) == 0))
+	   SCHEME_STR_LEN(obj1) == SCHEME_STR_LEN(obj2) &&
+	   (memcmp(SCHEME_STR_VAL(obj1), SCHEME_STR_VAL(obj2),
+		   SCHEME_STR_LEN(obj1)) == 0))
     {
       return 1;
     }
@@ -255,5 +249,10 @@ vector_equal (Scheme_Object *vec1, Scheme_Object *vec2)
   return 1;
 }
 
-
-
+static int
+numvec_equal (Scheme_Object *vec1, Scheme_Object *vec2, int el_size)
+{
+  return (SCHEME_NUMVEC_SIZE(vec1) == SCHEME_NUMVEC_SIZE(vec2) &&
+	  memcmp (SCHEME_U8VEC_ELS(vec1), SCHEME_U8VEC_ELS(vec2),
+		  SCHEME_NUMVEC_SIZE(vec1) * el_size) == 0);
+}
@@ -54,6 +54,7 @@ void
 scheme_init_char (Scheme_Env *env)
 {
   scheme_char_type = scheme_make_type ("<char>");
+  scheme_set_tag_type (scheme_make_char (0), 3, scheme_char_type);
   scheme_add_global ("<char>", scheme_char_type, env);
   scheme_add_global ("char?", scheme_make_prim (char_p), env);
   scheme_add_global ("char=?", scheme_make_prim (char_eq), env);
@@ -77,17 +78,6 @@ scheme_init_char (Scheme_Env *env)
   scheme_add_global ("char-downcase", scheme_make_prim (char_downcase), env);
 }
 
-Scheme_Object *
-scheme_make_char (char ch)
-{
-  Scheme_Object *sc;
-
-  sc = scheme_alloc_object ();
-  SCHEME_TYPE (sc) = scheme_char_type;
-  SCHEME_CHAR_VAL (sc) = ch;
-  return (sc);
-}
-
 /* locals */
 
 static Scheme_Object *
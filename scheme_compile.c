@@ -0,0 +1,627 @@
+/*
+  libscheme
+  Copyright (c) 1994 Brent Benson
+  All rights reserved.
+
+  Permission is hereby granted, without written agreement and without
+  license or royalty fees, to use, copy, modify, and distribute this
+  software and its documentation for any purpose, provided that the
+  above copyright notice and the following two paragraphs appear in
+  all copies of this software.
+
+  IN NO EVENT SHALL BRENT BENSON BE LIABLE TO ANY PARTY FOR DIRECT,
+  INDIRECT, SPECIAL, INCIDENTAL, OR CONSEQUENTIAL DAMAGES ARISING OUT
+  OF THE USE OF THIS SOFTWARE AND ITS DOCUMENTATION, EVEN IF BRENT
+  BENSON HAS BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+  BRENT BENSON SPECIFICALLY DISCLAIMS ANY WARRANTIES, INCLUDING, BUT
+  NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+  FITNESS FOR A PARTICULAR PURPOSE.  THE SOFTWARE PROVIDED HEREUNDER
+  IS ON AN "AS IS" BASIS, AND BRENT BENSON HAS NO OBLIGATION TO
+  PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR
+  MODIFICATIONS.
+*/
+
+#include "scheme.h"
+
+/* The compiler turns analyzed nodes into bytecode for
+   scheme_execute().  Each lambda gets a code object of its own; an
+   expression in tail position ends in RETURN, TAIL_CALL or
+   TAIL_MACRO, so calls from there reuse the caller's slot on the
+   stack.
+
+   The compiler also notes which frames can be captured.  A lambda,
+   delay, named let or a form only analyzed when it runs may keep
+   the environment it is made in; a frame whose scope holds none of
+   them dies when its scope is left, so it goes on the frame stack. */
+
+struct Code_Buffer
+{
+  int *ops;
+  int num_ops, ops_size;
+  Scheme_Object **consts;
+  int num_consts, consts_size;
+  int depth, max_depth;
+  int captures;			/* something so far may capture the env */
+};
+typedef struct Code_Buffer Code_Buffer;
+
+/* locals */
+static Scheme_Code *compile_code (Scheme_Node *body, Scheme_Node *lambda);
+static void compile (Code_Buffer *buf, Scheme_Node *node, int tail);
+static void compile_app (Code_Buffer *buf, Scheme_Node *node, int tail);
+static void compile_cond (Code_Buffer *buf, Scheme_Node *node, int tail);
+static void compile_case (Code_Buffer *buf, Scheme_Node *node, int tail);
+static void compile_do (Code_Buffer *buf, Scheme_Node *node, int tail);
+static int emit (Code_Buffer *buf, int op);
+static int emit_const (Code_Buffer *buf, void *obj);
+static int emit_site (Code_Buffer *buf, Scheme_Object *form);
+static void patch (Code_Buffer *buf, int pos);
+static void stack (Code_Buffer *buf, int n);
+static int begin_scope (Code_Buffer *buf);
+static void end_scope (Code_Buffer *buf, int captures, int pos);
+
+Scheme_Code *
+scheme_compile (Scheme_Node *node)
+{
+  return (compile_code (node, NULL));
+}
+
+/* local functions */
+
+static Scheme_Code *
+compile_code (Scheme_Node *body, Scheme_Node *lambda)
+{
+  Code_Buffer buf;
+  Scheme_Code *code;
+
+  buf.ops_size = 32;
+  buf.ops = (int *) scheme_malloc_atomic (buf.ops_size * sizeof (int));
+  buf.num_ops = 0;
+  buf.consts_size = 8;
+  buf.consts = (Scheme_Object **) scheme_malloc (buf.consts_size * sizeof (Scheme_Object *));
+  buf.num_consts = 0;
+  buf.depth = buf.max_depth = 0;
+  buf.captures = 0;
+  compile (&buf, body, 1);
+
+  code = (Scheme_Code *) scheme_malloc (sizeof (Scheme_Code));
+  code->ops = buf.ops;
+  code->consts = buf.consts;
+  code->max_depth = buf.max_depth;
+  code->stacked = ! buf.captures;
+  if (lambda)
+    {
+      code->num_params = lambda->num;
+      code->rest = (lambda->flags & SCHEME_REST_PARAM);
+      code->param_syms = lambda->syms;
+    }
+  else
+    {
+      code->num_params = 0;
+      code->rest = 0;
+      code->param_syms = NULL;
+    }
+  return (code);
+}
+
+static void
+compile (Code_Buffer *buf, Scheme_Node *node, int tail)
+{
+  int depth, i, jump, *jumps, captures;
+
+  switch (node->kind)
+    {
+    case SCHEME_CONST_NODE:
+      emit (buf, SCHEME_CONST_OP);
+      emit (buf, emit_const (buf, node->obj));
+      stack (buf, 1);
+      break;
+    case SCHEME_LOCAL_NODE:
+      if (node->depth == 0)
+	{
+	  emit (buf, SCHEME_LOCAL0_OP);
+	}
+      else
+	{
+	  emit (buf, SCHEME_LOCAL_OP);
+	  emit (buf, node->depth);
+	}
+      emit (buf, node->index);
+      stack (buf, 1);
+      break;
+    case SCHEME_GLOBAL_NODE:
+      emit (buf, SCHEME_GLOBAL_OP);
+      emit (buf, emit_const (buf, node->obj));
+      stack (buf, 1);
+      break;
+    case SCHEME_LOCAL_SET_NODE:
+      compile (buf, node->a, 0);
+      emit (buf, SCHEME_SET_LOCAL_OP);
+      emit (buf, node->depth);
+      emit (buf, node->index);
+      break;
+    case SCHEME_SET_NODE:
+      compile (buf, node->a, 0);
+      emit (buf, SCHEME_SET_GLOBAL_OP);
+      emit (buf, emit_const (buf, node->obj));
+      break;
+    case SCHEME_DEFINE_NODE:
+      compile (buf, node->a, 0);
+      emit (buf, SCHEME_DEFINE_OP);
+      emit (buf, emit_const (buf, node->obj));
+      break;
+    case SCHEME_IF_NODE:
+      compile (buf, node->a, 0);
+      emit (buf, SCHEME_JUMP_FALSE_OP);
+      jump = emit (buf, 0);
+      stack (buf, -1);
+      depth = buf->depth;
+      compile (buf, node->b, tail);
+      if (! tail)
+	{
+	  emit (buf, SCHEME_JUMP_OP);
+	  i = emit (buf, 0);
+	}
+      patch (buf, jump);
+      buf->depth = depth;
+      if (node->c)
+	{
+	  compile (buf, node->c, tail);
+	}
+      else
+	{
+	  compile (buf, scheme_make_const_node (scheme_false), tail);
+	}
+      if (! tail)
+	{
+	  patch (buf, i);
+	}
+      return;
+    case SCHEME_SEQ_NODE:
+      if (! node->num)
+	{
+	  compile (buf, scheme_make_const_node (scheme_false), tail);
+	  return;
+	}
+      for ( i=0 ; i<node->num-1 ; ++i )
+	{
+	  compile (buf, node->nodes[i], 0);
+	  emit (buf, SCHEME_POP_OP);
+	  stack (buf, -1);
+	}
+      compile (buf, node->nodes[i], tail);
+      return;
+    case SCHEME_AND_NODE:
+    case SCHEME_OR_NODE:
+      if (! node->num)
+	{
+	  compile (buf, scheme_make_const_node (node->kind == SCHEME_AND_NODE
+						? scheme_true : scheme_false),
+		   tail);
+	  return;
+	}
+      jumps = (int *) scheme_malloc_atomic (node->num * sizeof (int));
+      for ( i=0 ; i<node->num-1 ; ++i )
+	{
+	  compile (buf, node->nodes[i], 0);
+	  emit (buf, (node->kind == SCHEME_AND_NODE
+		      ? SCHEME_JUMP_FALSE_KEEP_OP : SCHEME_JUMP_TRUE_KEEP_OP));
+	  jumps[i] = emit (buf, 0);
+	  stack (buf, -1);
+	}
+      compile (buf, node->nodes[i], tail);
+      for ( i=0 ; i<node->num-1 ; ++i )
+	{
+	  patch (buf, jumps[i]);
+	}
+      if (tail)
+	{
+	  emit (buf, SCHEME_RETURN_OP);
+	}
+      return;
+    case SCHEME_APP_NODE:
+      compile_app (buf, node, tail);
+      return;
+    case SCHEME_SYNTAX_NODE:
+      buf->captures = 1;
+      emit (buf, SCHEME_SYNTAX_OP);
+      emit (buf, emit_site (buf, node->obj));
+      stack (buf, 1);
+      break;
+    case SCHEME_MACRO_NODE:
+      buf->captures = 1;
+      emit (buf, (tail ? SCHEME_TAIL_MACRO_OP : SCHEME_MACRO_OP));
+      emit (buf, emit_site (buf, node->obj));
+      stack (buf, 1);
+      return;
+    case SCHEME_LAMBDA_NODE:
+      buf->captures = 1;
+      emit (buf, SCHEME_CLOSURE_OP);
+      emit (buf, emit_const (buf, compile_code (node->a, node)));
+      stack (buf, 1);
+      break;
+    case SCHEME_LET_NODE:
+      for ( i=0 ; i<node->num ; ++i )
+	{
+	  compile (buf, node->nodes[i], 0);
+	}
+      captures = begin_scope (buf);
+      emit (buf, SCHEME_FRAME_OP);
+      emit (buf, node->num);
+      emit (buf, emit_const (buf, node->syms));
+      jump = emit (buf, 0);
+      stack (buf, -node->num);
+      compile (buf, node->a, tail);
+      end_scope (buf, captures, jump);
+      if (! tail)
+	{
+	  emit (buf, SCHEME_POP_FRAME_OP);
+	}
+      return;
+    case SCHEME_LETREC_NODE:
+      captures = begin_scope (buf);
+      emit (buf, SCHEME_EMPTY_FRAME_OP);
+      emit (buf, node->num);
+      emit (buf, emit_const (buf, node->syms));
+      jump = emit (buf, 0);
+      for ( i=0 ; i<node->num ; ++i )
+	{
+	  compile (buf, node->nodes[i], 0);
+	  emit (buf, SCHEME_SET_LOCAL_OP);
+	  emit (buf, 0);
+	  emit (buf, i);
+	  emit (buf, SCHEME_POP_OP);
+	  stack (buf, -1);
+	}
+      compile (buf, node->a, tail);
+      end_scope (buf, captures, jump);
+      if (! tail)
+	{
+	  emit (buf, SCHEME_POP_FRAME_OP);
+	}
+      return;
+    case SCHEME_NAMED_LET_NODE:
+      /* the inits run outside the frame that binds the name, and
+	 the closure goes under them as the operator */
+      for ( i=0 ; i<node->num ; ++i )
+	{
+	  compile (buf, node->nodes[i], 0);
+	}
+      /* the closure is kept in the frame it captures */
+      emit (buf, SCHEME_EMPTY_FRAME_OP);
+      emit (buf, 1);
+      emit (buf, emit_const (buf, node->syms));
+      emit (buf, 0);
+      compile (buf, node->a, 0);
+      emit (buf, SCHEME_SET_LOCAL_OP);
+      emit (buf, 0);
+      emit (buf, 0);
+      emit (buf, SCHEME_INSERT_OP);
+      emit (buf, node->num);
+      emit (buf, (tail ? SCHEME_TAIL_CALL_OP : SCHEME_CALL_OP));
+      emit (buf, node->num);
+      stack (buf, -node->num);
+      if (! tail)
+	{
+	  emit (buf, SCHEME_POP_FRAME_OP);
+	}
+      return;
+    case SCHEME_COND_NODE:
+      compile_cond (buf, node, tail);
+      return;
+    case SCHEME_CASE_NODE:
+      compile_case (buf, node, tail);
+      return;
+    case SCHEME_DO_NODE:
+      compile_do (buf, node, tail);
+      return;
+    case SCHEME_DELAY_NODE:
+      buf->captures = 1;
+      emit (buf, SCHEME_DELAY_OP);
+      emit (buf, emit_const (buf, compile_code (node->a, NULL)));
+      stack (buf, 1);
+      break;
+    case SCHEME_DEFMACRO_NODE:
+      buf->captures = 1;
+      emit (buf, SCHEME_DEFMACRO_OP);
+      emit (buf, emit_const (buf, compile_code (node->a->a, node->a)));
+      emit (buf, emit_const (buf, node->obj));
+      stack (buf, 1);
+      break;
+    default:
+      scheme_signal_error ("internal error: unknown node kind: %d", node->kind);
+    }
+  if (tail)
+    {
+      emit (buf, SCHEME_RETURN_OP);
+    }
+}
+
+static void
+compile_app (Code_Buffer *buf, Scheme_Node *node, int tail)
+{
+  int skip, i;
+
+  compile (buf, node->a, 0);
+  skip = -1;
+  /* an operator that is a variable may turn out to be syntax or a
+     macro by the time the form runs */
+  if (node->a->kind == SCHEME_GLOBAL_NODE || node->a->kind == SCHEME_LOCAL_NODE)
+    {
+      emit (buf, SCHEME_PROC_OP);
+      emit (buf, emit_site (buf, node->obj));
+      skip = emit (buf, 0);
+    }
+  for ( i=0 ; i<node->num ; ++i )
+    {
+      compile (buf, node->nodes[i], 0);
+    }
+  emit (buf, (tail ? SCHEME_TAIL_CALL_OP : SCHEME_CALL_OP));
+  emit (buf, node->num);
+  stack (buf, -node->num);
+  if (skip >= 0)
+    {
+      patch (buf, skip);
+      if (tail)
+	{
+	  emit (buf, SCHEME_RETURN_OP);
+	}
+    }
+}
+
+static void
+compile_cond (Code_Buffer *buf, Scheme_Node *node, int tail)
+{
+  Scheme_Node *clause;
+  int *ends;
+  int num_ends, next, i;
+
+  ends = (int *) scheme_malloc_atomic ((node->num + 1) * sizeof (int));
+  num_ends = 0;
+  for ( i=0 ; i<node->num ; ++i )
+    {
+      clause = node->nodes[i];
+      if (! clause->a)
+	{
+	  /* else */
+	  compile (buf, (clause->b ? clause->b : scheme_make_const_node (scheme_true)), tail);
+	  break;
+	}
+      compile (buf, clause->a, 0);
+      if (clause->flags & SCHEME_ARROW_CLAUSE)
+	{
+	  emit (buf, SCHEME_JUMP_TRUE_KEEP_OP);
+	  emit (buf, buf->num_ops + 3);
+	  emit (buf, SCHEME_JUMP_OP);
+	  next = emit (buf, 0);
+	  compile (buf, clause->b, 0);
+	  emit (buf, SCHEME_INSERT_OP);
+	  emit (buf, 1);
+	  emit (buf, (tail ? SCHEME_TAIL_CALL_OP : SCHEME_CALL_OP));
+	  emit (buf, 1);
+	  stack (buf, -1);
+	}
+      else if (! clause->b)
+	{
+	  /* a clause without a body gives the value of its test */
+	  emit (buf, SCHEME_JUMP_TRUE_KEEP_OP);
+	  ends[num_ends++] = emit (buf, 0);
+	  stack (buf, -1);
+	  continue;
+	}
+      else
+	{
+	  emit (buf, SCHEME_JUMP_FALSE_OP);
+	  next = emit (buf, 0);
+	  stack (buf, -1);
+	  compile (buf, clause->b, tail);
+	}
+      if (! tail)
+	{
+	  emit (buf, SCHEME_JUMP_OP);
+	  ends[num_ends++] = emit (buf, 0);
+	}
+      stack (buf, -1);
+      patch (buf, next);
+    }
+  if (i == node->num)
+    {
+      compile (buf, scheme_make_const_node (scheme_false), tail);
+    }
+  for ( i=0 ; i<num_ends ; ++i )
+    {
+      patch (buf, ends[i]);
+    }
+  if (tail && num_ends)
+    {
+      emit (buf, SCHEME_RETURN_OP);
+    }
+}
+
+static void
+compile_case (Code_Buffer *buf, Scheme_Node *node, int tail)
+{
+  Scheme_Node *clause;
+  int *ends;
+  int num_ends, next, i;
+
+  ends = (int *) scheme_malloc_atomic ((node->num + 1) * sizeof (int));
+  compile (buf, node->a, 0);
+  num_ends = 0;
+  for ( i=0 ; i<node->num ; ++i )
+    {
+      clause = node->nodes[i];
+      next = -1;
+      if (clause->obj)
+	{
+	  emit (buf, SCHEME_MEMV_OP);
+	  emit (buf, emit_const (buf, clause->obj));
+	  next = emit (buf, 0);
+	}
+      emit (buf, SCHEME_POP_OP);
+      stack (buf, -1);
+      compile (buf, clause->b, tail);
+      if (! clause->obj)
+	{
+	  break;
+	}
+      if (! tail)
+	{
+	  emit (buf, SCHEME_JUMP_OP);
+	  ends[num_ends++] = emit (buf, 0);
+	}
+      patch (buf, next);
+    }
+  if (i == node->num)
+    {
+      emit (buf, SCHEME_POP_OP);
+      stack (buf, -1);
+      compile (buf, scheme_make_const_node (scheme_false), tail);
+    }
+  for ( i=0 ; i<num_ends ; ++i )
+    {
+      patch (buf, ends[i]);
+    }
+}
+
+static void
+compile_do (Code_Buffer *buf, Scheme_Node *node, int tail)
+{
+  int top, body, end, syms, frame, reframe, captures, i;
+
+  for ( i=0 ; i<node->num ; ++i )
+    {
+      compile (buf, node->nodes[i], 0);
+    }
+  syms = emit_const (buf, node->syms);
+  captures = begin_scope (buf);
+  emit (buf, SCHEME_FRAME_OP);
+  emit (buf, node->num);
+  emit (buf, syms);
+  frame = emit (buf, 0);
+  stack (buf, -node->num);
+
+  top = buf->num_ops;
+  compile (buf, node->a, 0);
+  emit (buf, SCHEME_JUMP_FALSE_OP);
+  body = emit (buf, 0);
+  stack (buf, -1);
+  compile (buf, (node->b ? node->b : scheme_make_const_node (scheme_null)), tail);
+  end = -1;
+  if (! tail)
+    {
+      emit (buf, SCHEME_POP_FRAME_OP);
+      emit (buf, SCHEME_JUMP_OP);
+      end = emit (buf, 0);
+    }
+  stack (buf, -1);
+
+  /* each time round, the steps are bound in a fresh frame so
+     closures made by the body keep their own bindings */
+  patch (buf, body);
+  if (node->c)
+    {
+      compile (buf, node->c, 0);
+      emit (buf, SCHEME_POP_OP);
+      stack (buf, -1);
+    }
+  for ( i=0 ; i<node->num ; ++i )
+    {
+      compile (buf, node->nodes[node->num + i], 0);
+    }
+  emit (buf, SCHEME_REFRAME_OP);
+  emit (buf, node->num);
+  emit (buf, syms);
+  reframe = emit (buf, 0);
+  stack (buf, -node->num);
+  emit (buf, SCHEME_JUMP_OP);
+  emit (buf, top);
+  buf->ops[reframe] = ! buf->captures;
+  end_scope (buf, captures, frame);
+  if (! tail)
+    {
+      patch (buf, end);
+    }
+  stack (buf, 1);
+}
+
+static int
+emit (Code_Buffer *buf, int op)
+{
+  if (buf->num_ops == buf->ops_size)
+    {
+      buf->ops_size *= 2;
+      buf->ops = (int *) scheme_realloc (buf->ops, buf->ops_size * sizeof (int));
+    }
+  buf->ops[buf->num_ops] = op;
+  return (buf->num_ops++);
+}
+
+static int
+emit_const (Code_Buffer *buf, void *obj)
+{
+  if (buf->num_consts == buf->consts_size)
+    {
+      buf->consts_size *= 2;
+      buf->consts = (Scheme_Object **) scheme_realloc (buf->consts, buf->consts_size * sizeof (Scheme_Object *));
+    }
+  buf->consts[buf->num_consts] = (Scheme_Object *) obj;
+  return (buf->num_consts++);
+}
+
+/* A site is a form plus two slots in which scheme_execute() keeps
+   the code it expands the form to.  */
+
+static int
+emit_site (Code_Buffer *buf, Scheme_Object *form)
+{
+  int k;
+
+  k = emit_const (buf, form);
+  emit_const (buf, NULL);
+  emit_const (buf, NULL);
+  return (k);
+}
+
+/* point the jump whose operand is at pos to the next instruction */
+
+static void
+patch (Code_Buffer *buf, int pos)
+{
+  buf->ops[pos] = buf->num_ops;
+}
+
+static void
+stack (Code_Buffer *buf, int n)
+{
+  buf->depth += n;
+  if (buf->depth > buf->max_depth)
+    {
+      buf->max_depth = buf->depth;
+    }
+}
+
+/* Start compiling the scope of a frame.  Returns whether anything
+   before it may capture the env, for end_scope(). */
+
+static int
+begin_scope (Code_Buffer *buf)
+{
+  int captures;
+
+  captures = buf->captures;
+  buf->captures = 0;
+  return (captures);
+}
+
+/* Finish the scope of the frame made by the instruction whose
+   stacked operand is at pos.  A capture in the scope also captures
+   the frames around it. */
+
+static void
+end_scope (Code_Buffer *buf, int captures, int pos)
+{
+  buf->ops[pos] = ! buf->captures;
+  buf->captures |= captures;
+}
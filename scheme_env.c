@@ -24,13 +24,33 @@
 
 #include "scheme.h"
 
-#define GLOBAL_TABLE_SIZE 100313
-#define MAX_SYMBOL_SIZE 1023
+#define FRAME_BLOCK_SIZE 16384
+
+/* The frame stack.
+
+   Frames that no closure or promise can capture are bump-allocated
+   from a chain of blocks and released, last in first out, when the
+   code that made them returns, so most calls leave no garbage for
+   the collector.  The blocks come from the collector themselves: a
+   stacked frame captured after all, by code that was only analyzed
+   when it ran, stays valid because scheme_capture_env() gives up
+   the whole chain and leaves it to the collector. */
+
+struct Frame_Block
+{
+  struct Frame_Block *prev;
+  char *end;
+};
+typedef struct Frame_Block Frame_Block;
 
 /* globals */
 Scheme_Env *scheme_env;
+char *scheme_frame_top;
+char *scheme_frame_mark;
 
 /* locals */
+static Frame_Block *frame_block;
+static Frame_Block *spare_block;
 static Scheme_Env *scheme_make_env (void);
 
 Scheme_Env *
@@ -40,6 +60,7 @@ scheme_basic_env (void)
 
   /* The ordering of the first few init calls is important. 
      Add to the end of the list, not the beginning. */
+  scheme_init_alloc ();
   env = scheme_make_env ();
   scheme_init_type (env);
   scheme_init_fun (env);
@@ -49,6 +70,7 @@ scheme_basic_env (void)
   scheme_init_port (env);
   scheme_init_string (env);
   scheme_init_vector (env);
+  scheme_init_numvec (env);
   scheme_init_char (env);
   scheme_init_bool (env);
   scheme_init_syntax (env);
@@ -56,6 +78,8 @@ scheme_basic_env (void)
   scheme_init_error (env);
   scheme_init_promise (env);
   scheme_init_struct (env);
+  scheme_init_gc (env);
+  scheme_init_weak (env);
   scheme_env = env;
   return (env);
 }
@@ -66,39 +90,120 @@ scheme_make_env (void)
   Scheme_Env *env;
 
   env = (Scheme_Env *) scheme_malloc (sizeof (Scheme_Env));
-  env->globals = scheme_hash_table (GLOBAL_TABLE_SIZE);
+  env->num_bindings = 0;
   env->next = NULL;
   return (env);
 }
 
+/* Global bindings live in the symbols themselves, so a global
+   reference costs one load from the symbol's value cell. */
+
 void
 scheme_add_global (char *name, Scheme_Object *obj, Scheme_Env *env)
 {
-  char lower_name[MAX_SYMBOL_SIZE];
-  int i;
+  SCHEME_SYM_GLOBAL (scheme_intern_symbol (name)) = obj;
+}
+
+Scheme_Env *
+scheme_new_frame (int num_bindings, Scheme_Object **symbols)
+{
+  Scheme_Env *frame;
   
-  i = 0;
-  while ( name[i] )
+  frame = (Scheme_Env *) scheme_malloc (sizeof (Scheme_Env)
+					+ ((num_bindings > 1 ? num_bindings - 1 : 0)
+					   * sizeof (Scheme_Object*)));
+  frame->num_bindings = num_bindings;
+  frame->stacked = 0;
+  if (symbols)
     {
-      lower_name[i] = tolower (name[i]);
-      i++;
+      frame->symbols = symbols;
     }
-  lower_name[i] = '\0';
-  scheme_add_to_table (env->globals, lower_name, obj);
+  else
+    {
+      /* filled in by scheme_add_binding() */
+      frame->symbols = (Scheme_Object **) scheme_malloc (num_bindings * sizeof (Scheme_Object*));
+    }
+  return (frame);
 }
 
+/* A frame on the frame stack.  The caller keeps scheme_frame_top
+   from before the call and hands it to scheme_release_frames() once
+   the frame is dead. */
+
 Scheme_Env *
-scheme_new_frame (int num_bindings)
+scheme_new_stack_frame (int num_bindings, Scheme_Object **symbols)
 {
   Scheme_Env *frame;
-  
-  frame = (Scheme_Env *) scheme_malloc (sizeof (Scheme_Env));
+  Frame_Block *block;
+  int size;
+
+  size = (sizeof (Scheme_Env)
+	  + (num_bindings > 1 ? num_bindings - 1 : 0) * sizeof (Scheme_Object*));
+  if (! frame_block || scheme_frame_top + size > frame_block->end)
+    {
+      if (size > FRAME_BLOCK_SIZE)
+	{
+	  return (scheme_new_frame (num_bindings, symbols));
+	}
+      if (spare_block)
+	{
+	  block = spare_block;
+	  spare_block = NULL;
+	}
+      else
+	{
+	  block = (Frame_Block *) scheme_malloc (sizeof (Frame_Block) + FRAME_BLOCK_SIZE);
+	  block->end = (char *) (block + 1) + FRAME_BLOCK_SIZE;
+	}
+      block->prev = frame_block;
+      frame_block = block;
+      scheme_frame_top = (char *) (block + 1);
+    }
+  frame = (Scheme_Env *) scheme_frame_top;
+  scheme_frame_top += size;
   frame->num_bindings = num_bindings;
-  frame->symbols = (Scheme_Object **) scheme_malloc (num_bindings * sizeof (Scheme_Object*));
-  frame->values = (Scheme_Object **) scheme_malloc (num_bindings * sizeof (Scheme_Object*));
+  frame->stacked = 1;
+  frame->symbols = symbols;
   return (frame);
 }
 
+/* Release every stacked frame made since scheme_frame_top was mark.
+   A mark from a chain scheme_capture_env() gave up is older than
+   all of the current chain, so it releases the lot. */
+
+void
+scheme_release_frames (char *mark)
+{
+  while (frame_block
+	 && (mark < (char *) (frame_block + 1) || mark > frame_block->end))
+    {
+      spare_block = frame_block;
+      frame_block = frame_block->prev;
+    }
+  scheme_frame_top = (frame_block ? mark : NULL);
+}
+
+/* Called before env is kept in a closure or promise.  If a stacked
+   frame is in it, the frame stack moves to fresh blocks so the
+   frame is never reused. */
+
+void
+scheme_capture_env (Scheme_Env *env)
+{
+  int stacked;
+
+  for ( stacked=0 ; env ; env=env->next )
+    {
+      stacked |= env->stacked;
+      env->stacked = 0;
+    }
+  if (stacked)
+    {
+      frame_block = spare_block = NULL;
+      scheme_frame_top = NULL;
+    }
+}
+
 void
 scheme_add_binding (int index, Scheme_Object *sym, Scheme_Object *val, Scheme_Env *frame)
 {
@@ -113,7 +218,6 @@ scheme_add_binding (int index, Scheme_Object *sym, Scheme_Object *val, Scheme_En
 Scheme_Env *
 scheme_extend_env (Scheme_Env *frame, Scheme_Env *env)
 {
-  frame->globals = env->globals;
   frame->next = env;
   return (frame);
 }
@@ -124,11 +228,8 @@ scheme_add_frame (Scheme_Object *syms, Scheme_Object *vals, Scheme_Env *env)
   Scheme_Env *frame;
   int len, i;
 
-  frame = (Scheme_Env *) scheme_malloc (sizeof (Scheme_Env));
   len = scheme_list_length (syms);
-  frame->num_bindings = len;
-  frame->symbols = (Scheme_Object **) scheme_malloc (len * sizeof (Scheme_Object*));
-  frame->values = (Scheme_Object **) scheme_malloc (len * sizeof (Scheme_Object*));
+  frame = scheme_new_frame (len, NULL);
   for ( i=0 ; i<len ; ++i )
     {
       if (SCHEME_SYMBOLP(syms))
@@ -144,7 +245,6 @@ scheme_add_frame (Scheme_Object *syms, Scheme_Object *vals, Scheme_Env *env)
 	  vals = SCHEME_CDR (vals);
 	}
     }
-  frame->globals = env->globals;
   frame->next = env;
   scheme_env = frame;
   return (frame);
@@ -178,14 +278,7 @@ scheme_set_value (Scheme_Object *symbol, Scheme_Object *val, Scheme_Env *env)
 	}
       frame = frame->next;
     }
-  if (scheme_lookup_global (symbol, frame))
-    {
-      scheme_change_in_table (frame->globals, SCHEME_STR_VAL (symbol), val);
-    }
-  else
-    {
-      scheme_signal_error ("set!: var unbound: %s", SCHEME_STR_VAL(symbol));
-    }
+  scheme_set_global (symbol, val, frame);
 }
 
 Scheme_Object *
@@ -213,5 +306,18 @@ scheme_lookup_value (Scheme_Object *symbol, Scheme_Env *env)
 Scheme_Object *
 scheme_lookup_global (Scheme_Object *symbol, Scheme_Env *env)
 {
-  return (scheme_lookup_in_table (env->globals, SCHEME_STR_VAL(symbol)));
+  return (SCHEME_SYM_GLOBAL (symbol));
+}
+
+void
+scheme_set_global (Scheme_Object *symbol, Scheme_Object *val, Scheme_Env *env)
+{
+  if (SCHEME_SYM_GLOBAL (symbol))
+    {
+      SCHEME_SYM_GLOBAL (symbol) = val;
+    }
+  else
+    {
+      scheme_signal_error ("set!: var unbound: %s", SCHEME_STR_VAL(symbol));
+    }
 }
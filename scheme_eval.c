@@ -24,79 +24,531 @@
 
 #include "scheme.h"
 
+#define SEGMENT_SIZE 16384
+#define MAX_SEGMENTS 256
+
+/* The value stack holds the VM's temporaries and call records, and
+   the args of every call, whichever path makes it.  It is a chain of
+   segments; when one is full the stack goes on in the next, which is
+   made as big as it needs to be, so a call can take any number of
+   args.  Segments are kept once made, and scanned by the collector
+   like any other object. */
+
+struct Stack_Segment
+{
+  struct Stack_Segment *prev, *next;
+  Scheme_Object **end;
+  int depth;			/* segments up to this one */
+  Scheme_Object *slots[1];
+};
+typedef struct Stack_Segment Stack_Segment;
+
+/* globals */
+Scheme_Object **scheme_stack_top;
+Scheme_Object **scheme_stack_mark;
+Scheme_Object **scheme_stack_limit;
+
 /* locals */
-static Scheme_Object *scheme_eval_combination (Scheme_Object *comb, Scheme_Env *env);
+static Stack_Segment *segment;
+static Stack_Segment *make_segment (int size, Stack_Segment *prev);
+static void reserve_stack (int n);
 static Scheme_Object *eval (int argc, Scheme_Object *argv[]);
+static Scheme_Code *special_code (Scheme_Object **site, Scheme_Object *rator, Scheme_Env *env);
 
 void
 scheme_init_eval (Scheme_Env *env)
 {
+  segment = make_segment (SEGMENT_SIZE, NULL);
+  scheme_stack_top = segment->slots;
+  scheme_stack_limit = segment->end;
   scheme_add_global ("eval", scheme_make_prim (eval), env);
 }
 
 Scheme_Object *
 scheme_eval (Scheme_Object *obj, Scheme_Env *env)
 {
-  Scheme_Object *type;
+  return (scheme_execute (scheme_compile (scheme_analyze (obj, env)), env));
+}
+
+/* Take n slots from the top of the value stack for the args of a
+   call.  The caller keeps scheme_stack_top from before and hands it
+   to scheme_reset_stack() when the call is over. */
 
-  type = SCHEME_TYPE (obj);
-  if (type == scheme_symbol_type)
+Scheme_Object **
+scheme_alloc_args (int n)
+{
+  Scheme_Object **args;
+
+  reserve_stack (n);
+  args = scheme_stack_top;
+  scheme_stack_top += n;
+  return (args);
+}
+
+/* Cut the value stack back to mark, and go back to the segment it
+   is in. */
+
+void
+scheme_reset_stack (Scheme_Object **mark)
+{
+  while (mark < segment->slots || mark > segment->end)
     {
-      Scheme_Object *val;
+      segment = segment->prev;
+    }
+  scheme_stack_top = mark;
+  scheme_stack_limit = segment->end;
+}
+
+/* The virtual machine.
+
+   Values are kept on an explicit stack.  A call to a closure pushes
+   the caller's code, pc and env and continues in the closure's code;
+   RETURN pops them again, and a tail call skips the push, so Scheme
+   calls never nest C calls.  The caller's mark on the frame stack
+   goes with them: a return or tail call releases the stacked frames
+   of the call it ends.  A nested scheme_execute() -- from a
+   primitive that applies a procedure, say -- starts its stack at
+   scheme_stack_top, which is kept above the live part of the stack
+   whenever control leaves the VM.  Code that does not fit in what
+   is left of the segment runs in a nested scheme_execute() on the
+   next one. */
+
+#define PUSH(v)   (*sp++ = (Scheme_Object *) (v))
+#define POP()     (*--sp)
+#define TOP()     (sp[-1])
+#define SAVE_SP() (scheme_stack_top = sp)
 
-      val = scheme_lookup_value (obj, env);
+#ifdef __GNUC__
+# define CASE(op) op##_LABEL:
+# define NEXT     goto *dispatch[*pc++]
+#else
+# define CASE(op) case op:
+# define NEXT     goto next
+#endif
+
+Scheme_Object *
+scheme_execute (Scheme_Code *code, Scheme_Env *env)
+{
+  Scheme_Object **sp, **base, **limit, **consts, **site;
+  Scheme_Object *val, *rator;
+  Scheme_Code *new_code;
+  Scheme_Env *frame;
+  char *mark, *top;
+  int *pc;
+  int n, i;
+#ifdef __GNUC__
+  static void *dispatch[SCHEME_NUM_OPS] = {
+    [SCHEME_CONST_OP] = &&SCHEME_CONST_OP_LABEL,
+    [SCHEME_LOCAL0_OP] = &&SCHEME_LOCAL0_OP_LABEL,
+    [SCHEME_LOCAL_OP] = &&SCHEME_LOCAL_OP_LABEL,
+    [SCHEME_GLOBAL_OP] = &&SCHEME_GLOBAL_OP_LABEL,
+    [SCHEME_SET_LOCAL_OP] = &&SCHEME_SET_LOCAL_OP_LABEL,
+    [SCHEME_SET_GLOBAL_OP] = &&SCHEME_SET_GLOBAL_OP_LABEL,
+    [SCHEME_DEFINE_OP] = &&SCHEME_DEFINE_OP_LABEL,
+    [SCHEME_POP_OP] = &&SCHEME_POP_OP_LABEL,
+    [SCHEME_INSERT_OP] = &&SCHEME_INSERT_OP_LABEL,
+    [SCHEME_JUMP_OP] = &&SCHEME_JUMP_OP_LABEL,
+    [SCHEME_JUMP_FALSE_OP] = &&SCHEME_JUMP_FALSE_OP_LABEL,
+    [SCHEME_JUMP_FALSE_KEEP_OP] = &&SCHEME_JUMP_FALSE_KEEP_OP_LABEL,
+    [SCHEME_JUMP_TRUE_KEEP_OP] = &&SCHEME_JUMP_TRUE_KEEP_OP_LABEL,
+    [SCHEME_MEMV_OP] = &&SCHEME_MEMV_OP_LABEL,
+    [SCHEME_PROC_OP] = &&SCHEME_PROC_OP_LABEL,
+    [SCHEME_CALL_OP] = &&SCHEME_CALL_OP_LABEL,
+    [SCHEME_TAIL_CALL_OP] = &&SCHEME_TAIL_CALL_OP_LABEL,
+    [SCHEME_RETURN_OP] = &&SCHEME_RETURN_OP_LABEL,
+    [SCHEME_CLOSURE_OP] = &&SCHEME_CLOSURE_OP_LABEL,
+    [SCHEME_FRAME_OP] = &&SCHEME_FRAME_OP_LABEL,
+    [SCHEME_EMPTY_FRAME_OP] = &&SCHEME_EMPTY_FRAME_OP_LABEL,
+    [SCHEME_REFRAME_OP] = &&SCHEME_REFRAME_OP_LABEL,
+    [SCHEME_POP_FRAME_OP] = &&SCHEME_POP_FRAME_OP_LABEL,
+    [SCHEME_SYNTAX_OP] = &&SCHEME_SYNTAX_OP_LABEL,
+    [SCHEME_MACRO_OP] = &&SCHEME_MACRO_OP_LABEL,
+    [SCHEME_TAIL_MACRO_OP] = &&SCHEME_TAIL_MACRO_OP_LABEL,
+    [SCHEME_DELAY_OP] = &&SCHEME_DELAY_OP_LABEL,
+    [SCHEME_DEFMACRO_OP] = &&SCHEME_DEFMACRO_OP_LABEL
+  };
+#endif
+
+  sp = base = scheme_stack_top;
+  limit = scheme_stack_limit;
+  mark = scheme_frame_top;
+
+ start:
+  /* four more slots for the frame of a call out of this code */
+  if (sp + code->max_depth + 4 > limit)
+    {
+      if (segment->depth >= MAX_SEGMENTS)
+	{
+	  scheme_signal_error ("stack overflow");
+	}
+      SAVE_SP ();
+      reserve_stack (code->max_depth + 4);
+      val = scheme_execute (code, env);
+      scheme_reset_stack (sp);
+      goto do_return;
+    }
+  pc = code->ops;
+  consts = code->consts;
+  NEXT;
+
+#ifndef __GNUC__
+ next:
+  switch (*pc++)
+    {
+#endif
+    CASE (SCHEME_CONST_OP)
+      PUSH (consts[*pc++]);
+      NEXT;
+    CASE (SCHEME_LOCAL0_OP)
+      PUSH (env->values[*pc++]);
+      NEXT;
+    CASE (SCHEME_LOCAL_OP)
+      for ( frame=env, n=*pc++ ; n ; --n )
+	{
+	  frame = frame->next;
+	}
+      PUSH (frame->values[*pc++]);
+      NEXT;
+    CASE (SCHEME_GLOBAL_OP)
+      val = SCHEME_SYM_GLOBAL (consts[*pc]);
       if (! val)
 	{
-	  scheme_signal_error ("reference to unbound symbol: %s", SCHEME_STR_VAL(obj));
+	  scheme_signal_error ("reference to unbound symbol: %s", SCHEME_STR_VAL (consts[*pc]));
+	}
+      pc++;
+      PUSH (val);
+      NEXT;
+    CASE (SCHEME_SET_LOCAL_OP)
+      for ( frame=env, n=*pc++ ; n ; --n )
+	{
+	  frame = frame->next;
+	}
+      frame->values[*pc++] = TOP ();
+      NEXT;
+    CASE (SCHEME_SET_GLOBAL_OP)
+      scheme_set_global (consts[*pc++], TOP (), env);
+      NEXT;
+    CASE (SCHEME_DEFINE_OP)
+      SCHEME_SYM_GLOBAL (consts[*pc]) = TOP ();
+      TOP () = consts[*pc++];
+      NEXT;
+    CASE (SCHEME_POP_OP)
+      --sp;
+      NEXT;
+    CASE (SCHEME_INSERT_OP)
+      val = TOP ();
+      for ( n=*pc++, i=1 ; i<=n ; ++i )
+	{
+	  sp[-i] = sp[-i-1];
+	}
+      sp[-n-1] = val;
+      NEXT;
+    CASE (SCHEME_JUMP_OP)
+      pc = code->ops + *pc;
+      NEXT;
+    CASE (SCHEME_JUMP_FALSE_OP)
+      if (POP () == scheme_false)
+	{
+	  pc = code->ops + *pc;
+	  NEXT;
+	}
+      pc++;
+      NEXT;
+    CASE (SCHEME_JUMP_FALSE_KEEP_OP)
+      if (TOP () == scheme_false)
+	{
+	  pc = code->ops + *pc;
+	  NEXT;
+	}
+      --sp;
+      pc++;
+      NEXT;
+    CASE (SCHEME_JUMP_TRUE_KEEP_OP)
+      if (TOP () != scheme_false)
+	{
+	  pc = code->ops + *pc;
+	  NEXT;
+	}
+      --sp;
+      pc++;
+      NEXT;
+    CASE (SCHEME_MEMV_OP)
+      for ( val=consts[*pc] ; SCHEME_PAIRP (val) ; val=SCHEME_CDR (val) )
+	{
+	  if (scheme_eqv (SCHEME_CAR (val), TOP ()))
+	    {
+	      break;
+	    }
+	}
+      pc = (SCHEME_PAIRP (val) ? pc + 2 : code->ops + pc[1]);
+      NEXT;
+    CASE (SCHEME_PROC_OP)
+      rator = TOP ();
+      if (! SCHEME_HEAP_TYPEP (rator, scheme_syntax_type)
+	  && ! SCHEME_HEAP_TYPEP (rator, scheme_macro_type))
+	{
+	  pc += 2;
+	  NEXT;
+	}
+      /* the operator was not known to be syntax when the form
+	 was analyzed */
+      --sp;
+      site = consts + pc[0];
+      pc = code->ops + pc[1];
+      SAVE_SP ();
+      if (SCHEME_SYNTAXP (rator) && ! SCHEME_ANALYZER (rator))
+	{
+	  PUSH (SCHEME_SYNTAX (rator) (site[0], env));
+	  NEXT;
+	}
+      new_code = special_code (site, rator, env);
+      goto enter;
+    CASE (SCHEME_CALL_OP)
+      n = *pc++;
+      rator = sp[-n-1];
+      if (SCHEME_HEAP_TYPEP (rator, scheme_closure_type))
+	{
+	  top = scheme_frame_top;
+	  frame = scheme_closure_frame (rator, n, sp - n);
+	  sp -= n + 1;
+	  PUSH (code);
+	  PUSH (pc);
+	  PUSH (env);
+	  PUSH (mark);
+	  code = SCHEME_CLOS_CODE (rator);
+	  env = frame;
+	  mark = top;
+	  goto start;
+	}
+      SAVE_SP ();
+      if (SCHEME_HEAP_TYPEP (rator, scheme_prim_type))
+	{
+	  val = SCHEME_PRIM (rator) (n, sp - n);
+	}
+      else
+	{
+	  val = scheme_apply (rator, n, sp - n);
+	}
+      sp -= n + 1;
+      PUSH (val);
+      NEXT;
+    CASE (SCHEME_TAIL_CALL_OP)
+      n = *pc++;
+      rator = sp[-n-1];
+      if (SCHEME_HEAP_TYPEP (rator, scheme_closure_type))
+	{
+	  scheme_release_frames (mark);
+	  env = scheme_closure_frame (rator, n, sp - n);
+	  sp -= n + 1;
+	  code = SCHEME_CLOS_CODE (rator);
+	  goto start;
+	}
+      SAVE_SP ();
+      if (SCHEME_HEAP_TYPEP (rator, scheme_prim_type))
+	{
+	  val = SCHEME_PRIM (rator) (n, sp - n);
+	}
+      else
+	{
+	  val = scheme_apply (rator, n, sp - n);
+	}
+      sp -= n + 1;
+      goto do_return;
+    CASE (SCHEME_RETURN_OP)
+      val = POP ();
+    do_return:
+      scheme_release_frames (mark);
+      if (sp == base)
+	{
+	  scheme_stack_top = base;
+	  return (val);
+	}
+      mark = (char *) POP ();
+      env = (Scheme_Env *) POP ();
+      pc = (int *) POP ();
+      code = (Scheme_Code *) POP ();
+      consts = code->consts;
+      PUSH (val);
+      NEXT;
+    CASE (SCHEME_CLOSURE_OP)
+      PUSH (scheme_make_closure (env, (Scheme_Code *) consts[*pc++]));
+      NEXT;
+    CASE (SCHEME_REFRAME_OP)
+      if (env->stacked)
+	{
+	  /* nothing kept the old frame, so it can be reused */
+	  n = pc[0];
+	  for ( i=0 ; i<n ; ++i )
+	    {
+	      env->values[i] = sp[i-n];
+	    }
+	  sp -= n;
+	  pc += 3;
+	  NEXT;
+	}
+      env = env->next;
+      /* fall through */
+    CASE (SCHEME_FRAME_OP)
+      n = pc[0];
+      if (pc[2])
+	{
+	  frame = scheme_new_stack_frame (n, (Scheme_Object **) consts[pc[1]]);
+	}
+      else
+	{
+	  frame = scheme_new_frame (n, (Scheme_Object **) consts[pc[1]]);
+	}
+      for ( i=0 ; i<n ; ++i )
+	{
+	  frame->values[i] = sp[i-n];
+	}
+      sp -= n;
+      env = scheme_extend_env (frame, env);
+      pc += 3;
+      NEXT;
+    CASE (SCHEME_EMPTY_FRAME_OP)
+      n = pc[0];
+      if (pc[2])
+	{
+	  frame = scheme_new_stack_frame (n, (Scheme_Object **) consts[pc[1]]);
+	}
+      else
+	{
+	  frame = scheme_new_frame (n, (Scheme_Object **) consts[pc[1]]);
 	}
-      return (val);
+      for ( i=0 ; i<n ; ++i )
+	{
+	  frame->values[i] = scheme_false;
+	}
+      env = scheme_extend_env (frame, env);
+      pc += 3;
+      NEXT;
+    CASE (SCHEME_POP_FRAME_OP)
+      if (env->stacked)
+	{
+	  scheme_release_frames ((char *) env);
+	}
+      env = env->next;
+      NEXT;
+    CASE (SCHEME_SYNTAX_OP)
+      site = consts + *pc++;
+      rator = SCHEME_SYM_GLOBAL (SCHEME_CAR (site[0]));
+      SAVE_SP ();
+      if (rator && SCHEME_TYPE (rator) == scheme_syntax_type && ! SCHEME_ANALYZER (rator))
+	{
+	  PUSH (SCHEME_SYNTAX (rator) (site[0], env));
+	  NEXT;
+	}
+      new_code = special_code (site, rator, env);
+      goto enter;
+    CASE (SCHEME_MACRO_OP)
+      site = consts + *pc++;
+      SAVE_SP ();
+      new_code = special_code (site, SCHEME_SYM_GLOBAL (SCHEME_CAR (site[0])), env);
+    enter:
+      /* run new_code in the current env and come back to pc */
+      PUSH (code);
+      PUSH (pc);
+      PUSH (env);
+      PUSH (mark);
+      code = new_code;
+      mark = scheme_frame_top;
+      goto start;
+    CASE (SCHEME_TAIL_MACRO_OP)
+      site = consts + *pc++;
+      SAVE_SP ();
+      code = special_code (site, SCHEME_SYM_GLOBAL (SCHEME_CAR (site[0])), env);
+      goto start;
+    CASE (SCHEME_DELAY_OP)
+      PUSH (scheme_make_code_promise ((Scheme_Code *) consts[*pc++], env));
+      NEXT;
+    CASE (SCHEME_DEFMACRO_OP)
+      val = scheme_alloc_typed_object (scheme_macro_type);
+      SCHEME_PTR_VAL (val) = scheme_make_closure (env, (Scheme_Code *) consts[pc[0]]);
+      SCHEME_SYM_GLOBAL (consts[pc[1]]) = val;
+      pc += 2;
+      PUSH (val);
+      NEXT;
+#ifndef __GNUC__
+    default:
+      scheme_signal_error ("internal error: bad opcode: %d", pc[-1]);
     }
-  else if (type == scheme_pair_type)
+#endif
+  return (NULL);
+}
+
+/* local functions */
+
+static Stack_Segment *
+make_segment (int size, Stack_Segment *prev)
+{
+  Stack_Segment *seg;
+
+  seg = (Stack_Segment *) scheme_malloc (sizeof (Stack_Segment)
+					 + (size - 1) * sizeof (Scheme_Object *));
+  seg->prev = prev;
+  seg->next = NULL;
+  seg->end = seg->slots + size;
+  seg->depth = (prev ? prev->depth : 0) + 1;
+  return (seg);
+}
+
+/* Make room for n more slots on the value stack, going on to the
+   next segment if this one is too full. */
+
+static void
+reserve_stack (int n)
+{
+  if (scheme_stack_top + n <= scheme_stack_limit)
     {
-      return (scheme_eval_combination (obj, env));
+      return;
     }
-  else
+  if (! segment->next || segment->next->end - segment->next->slots < n)
     {
-      return (obj);
+      segment->next = make_segment ((n > SEGMENT_SIZE ? n : SEGMENT_SIZE), segment);
     }
+  segment = segment->next;
+  scheme_stack_top = segment->slots;
+  scheme_stack_limit = segment->end;
 }
 
-/* local functions */
+/* Get the code for a macro use, or for a form whose operator turned
+   out to be syntax or a macro only when it ran.  The site is three
+   constants: the form, the operator value rator that the code was
+   made for, and the code.  The code is reused for as long as the
+   operator keeps that value, so a macro is expanded once per use,
+   and again only after it is redefined.  A site always runs with
+   frames of the same shape, so its code can be kept whatever env
+   it was compiled in. */
 
-static Scheme_Object *
-scheme_eval_combination (Scheme_Object *comb, Scheme_Env *env)
+static Scheme_Code *
+special_code (Scheme_Object **site, Scheme_Object *rator, Scheme_Env *env)
 {
-  Scheme_Object *rator, *type, *rands;
-  Scheme_Object *evaled_rands[SCHEME_MAX_ARGS];
-  Scheme_Object *rand, *fun, *form;
-  int num_rands, i;
-
-  rator = scheme_eval (SCHEME_CAR (comb), env);
-  type = SCHEME_TYPE (rator);
-  if (type == scheme_syntax_type)
+  Scheme_Object *form;
+  Scheme_Code *code;
+
+  if (site[2] && site[1] == rator)
+    {
+      return ((Scheme_Code *) site[2]);
+    }
+  form = site[0];
+  if (rator && SCHEME_TYPE (rator) == scheme_macro_type)
     {
-      return (SCHEME_SYNTAX(rator)(comb, env));
+      form = scheme_apply_to_list ((Scheme_Object *) SCHEME_PTR_VAL (rator),
+				   SCHEME_CDR (form));
+      code = scheme_compile (scheme_analyze (form, env));
     }
-  else if (type == scheme_macro_type)
+  else if (rator && SCHEME_TYPE (rator) == scheme_syntax_type && SCHEME_ANALYZER (rator))
     {
-      fun = (Scheme_Object *) SCHEME_PTR_VAL (rator);
-      rands = SCHEME_CDR (comb);
-      form = scheme_apply_to_list (fun, rands);
-      return (scheme_eval (form, env));
+      code = scheme_compile (SCHEME_ANALYZER (rator) (form, env));
     }
   else
     {
-      rands = SCHEME_CDR (comb);
-      num_rands = scheme_list_length (rands);
-      i = 0;
-      while (rands != scheme_null)
-	{
-	  evaled_rands[i] = scheme_eval (SCHEME_CAR (rands), env);
-	  i++;
-	  rands = SCHEME_CDR (rands);
-	}
-      return (scheme_apply (rator, num_rands, evaled_rands));
+      code = scheme_compile (scheme_analyze (form, env));
     }
+  site[1] = rator;
+  site[2] = (Scheme_Object *) code;
+  return (code);
 }
 
 static Scheme_Object *
@@ -45,9 +45,9 @@ static Scheme_Object *call_cc (int argc, Scheme_Object *argv[]);
 void
 scheme_init_fun (Scheme_Env *env)
 {
-  scheme_prim_type = scheme_make_type ("<primitive>");
+  scheme_prim_type = scheme_make_layout_type ("<primitive>", SCHEME_LAYOUT_NONE);
   scheme_closure_type = scheme_make_type ("<closure>");
-  scheme_cont_type = scheme_make_type ("<continuation>");
+  scheme_cont_type = scheme_make_layout_type ("<continuation>", SCHEME_LAYOUT_PTR1);
   scheme_add_global ("<primitive>", scheme_prim_type, env);
   scheme_add_global ("<closure>", scheme_closure_type, env);
   scheme_add_global ("<continuation>", scheme_cont_type, env);
@@ -64,19 +64,19 @@ scheme_make_prim (Scheme_Prim *fun)
 {
   Scheme_Object *prim;
 
-  prim = scheme_alloc_object ();
-  SCHEME_TYPE (prim) = scheme_prim_type;
+  prim = scheme_alloc_typed_object (scheme_prim_type);
   SCHEME_PRIM (prim) = fun;
   return (prim);
 }
 
 Scheme_Object *
-scheme_make_closure (Scheme_Env *env, Scheme_Object *code)
+scheme_make_closure (Scheme_Env *env, Scheme_Code *code)
 {
   Scheme_Object *closure;
 
+  scheme_capture_env (env);
   closure = scheme_alloc_object ();
-  SCHEME_TYPE (closure) = scheme_closure_type;
+  _SCHEME_TYPE (closure) = scheme_closure_type;
   SCHEME_CLOS_ENV (closure) = env;
   SCHEME_CLOS_CODE (closure) = code;
   return (closure);
@@ -87,8 +87,7 @@ scheme_make_cont (Scheme_Jmpbuf sbuf)
 {
   Scheme_Object *cont;
 
-  cont = scheme_alloc_object ();
-  SCHEME_TYPE (cont) = scheme_cont_type;
+  cont = scheme_alloc_typed_object (scheme_cont_type);
   SCHEME_PTR_VAL (cont) = sbuf;
   return (cont);
 }
@@ -96,125 +95,17 @@ scheme_make_cont (Scheme_Jmpbuf sbuf)
 Scheme_Object *
 scheme_apply (Scheme_Object *rator, int num_rands, Scheme_Object **rands)
 {
-  Scheme_Object *fun_type;
+  Scheme_Object *fun_type, *val;
+  char *mark;
 
   fun_type = SCHEME_TYPE (rator);
   if (fun_type == scheme_closure_type)
     {
-      Scheme_Env *env, *frame;
-      Scheme_Object *params, *forms, *ret, *t1, *t2;
-      Scheme_Object *vars, *vals, *vars_last, *vals_last, *pair, *aform;
-      int num_int_defs, num_params, i, has_rest;
-
-      env = SCHEME_CLOS_ENV (rator);
-      params = SCHEME_CAR (SCHEME_CLOS_CODE (rator));
-      num_params = scheme_list_length (params);
-      frame = scheme_new_frame (num_params);
-      has_rest = 0;
-      for ( i=0 ; i<num_params ; ++i )
-	{
-	  if (! SCHEME_PAIRP (params))
-	    {
-	      Scheme_Object *rest_vals;
-
-	      rest_vals = scheme_collect_rest ((num_rands - i), (rands + i));
-	      scheme_add_binding (i, params, rest_vals, frame);
-	      has_rest = 1;
-	    }
-	  else
-	    {
-	      scheme_add_binding (i, SCHEME_CAR (params), rands[i], frame);
-	      params = SCHEME_CDR (params);
-	    }
-	}
-      if ( has_rest )
-	{
-	  if (num_rands < (num_params - 1))
-	    {
-	      scheme_signal_error ("too few arguments to procedure");
-	    }
-	}
-      else
-	{
-	  if (num_rands < num_params)
-	    {
-	      scheme_signal_error ("too few arguments to procedure");
-	    }
-	  if (num_rands > num_params)
-	    {
-	      scheme_signal_error ("too many arguments to procedure");
-	    }
-	}
-      env = scheme_extend_env (frame, env);
-      forms = SCHEME_CDR (SCHEME_CLOS_CODE (rator));
-      SCHEME_ASSERT (forms != scheme_null, "apply: no forms in closure body");
-
-      /* process internal defines */
-      num_int_defs = 0;
-      vars = vals = vars_last = vals_last = scheme_null;
-      while (!SCHEME_NULLP(forms) && 
-	     SCHEME_PAIRP (SCHEME_CAR(forms)) &&
-	     SCHEME_CAR (SCHEME_CAR (forms)) == scheme_intern_symbol ("define"))
-	{
-	  num_int_defs++;
-	  aform = SCHEME_CAR (forms);
-	  /* get var */
-	  if (SCHEME_PAIRP (SCHEME_CAR (SCHEME_CDR (aform))))
-	    pair = scheme_make_pair (SCHEME_CAR (SCHEME_CAR (SCHEME_CDR (aform))), scheme_null);
-	  else
-	    pair = scheme_make_pair (SCHEME_CAR (SCHEME_CDR (aform)), scheme_null);
-	  
-	  if (SCHEME_NULLP (vars))
-	    vars = vars_last = pair;
-	  else
-	    {
-	      SCHEME_CDR (vars_last) = pair;
-	      vars_last = pair;
-	    }
-	  /* get val */
-	  if (SCHEME_PAIRP (SCHEME_CAR (SCHEME_CDR (aform))))
-	    pair = CONS (CONS (scheme_intern_symbol("lambda"),
-			       CONS (SCHEME_CDR (SCHEME_CAR (SCHEME_CDR (aform))),
-				     SCHEME_CDR (SCHEME_CDR (aform)))),
-			 scheme_null);
-	  else
-	    pair = scheme_make_pair (SCHEME_CAR (SCHEME_CDR (SCHEME_CDR (aform))), scheme_null);
-
-	  if (SCHEME_NULLP (vals))
-	    vals = vals_last = pair;
-	  else
-	    {
-	      SCHEME_CDR (vals_last) = pair;
-	      vals_last = pair;
-	    }
-	  forms = SCHEME_CDR (forms);
-	}
-      if ( num_int_defs )
-	{
-	  env = scheme_add_frame (vars, scheme_alloc_list (num_int_defs), env);
-	  while (! SCHEME_NULLP (vars))
-	    {
-	      scheme_set_value (SCHEME_CAR(vars),
-				scheme_eval (SCHEME_CAR (vals), env),
-				env);
-	      vars = SCHEME_CDR (vars);
-	      vals = SCHEME_CDR (vals);
-	    }
-	}
-
-      while (forms != scheme_null)
-	{
-	  ret = scheme_eval (SCHEME_CAR (forms), env);
-	  forms = SCHEME_CDR (forms);
-	}
-      /* pop internal define frame */
-      if ( num_int_defs )
-	{
-	  env = scheme_pop_frame (env);
-	}
-      /* pop regular binding frame */
-      env = scheme_pop_frame (env);
-      return (ret);
+      mark = scheme_frame_top;
+      val = scheme_execute (SCHEME_CLOS_CODE (rator),
+			    scheme_closure_frame (rator, num_rands, rands));
+      scheme_release_frames (mark);
+      return (val);
     }
   else if (fun_type == scheme_prim_type)
     {
@@ -239,19 +130,76 @@ scheme_apply (Scheme_Object *rator, int num_rands, Scheme_Object **rands)
     }
 }
 
+/* Bind a closure's parameters to the given args in a new frame on
+   top of the closure's environment, ready for its body to run in.
+   The frame is on the frame stack if the closure's code allows it,
+   for the caller to release when the body returns. */
+
+Scheme_Env *
+scheme_closure_frame (Scheme_Object *closure, int num_rands, Scheme_Object **rands)
+{
+  Scheme_Env *frame;
+  Scheme_Code *code;
+  int num_params, i;
+
+  code = SCHEME_CLOS_CODE (closure);
+  num_params = code->num_params;
+  if (code->rest)
+    {
+      if (num_rands < (num_params - 1))
+	{
+	  scheme_signal_error ("too few arguments to procedure");
+	}
+      num_params--;
+    }
+  else
+    {
+      if (num_rands < num_params)
+	{
+	  scheme_signal_error ("too few arguments to procedure");
+	}
+      if (num_rands > num_params)
+	{
+	  scheme_signal_error ("too many arguments to procedure");
+	}
+    }
+
+  if (code->stacked)
+    {
+      frame = scheme_new_stack_frame (code->num_params, code->param_syms);
+    }
+  else
+    {
+      frame = scheme_new_frame (code->num_params, code->param_syms);
+    }
+  for ( i=0 ; i<num_params ; ++i )
+    {
+      frame->values[i] = rands[i];
+    }
+  if (code->rest)
+    {
+      frame->values[i] = scheme_collect_rest ((num_rands - i), (rands + i));
+    }
+  return (scheme_extend_env (frame, SCHEME_CLOS_ENV (closure)));
+}
+
 Scheme_Object *
 scheme_apply_to_list (Scheme_Object *rator, Scheme_Object *rands)
 {
+  Scheme_Object **mark, **rands_vec, *val;
   int num_rands, i;
-  Scheme_Object *rands_vec[SCHEME_MAX_ARGS];
 
   num_rands = scheme_list_length (rands);
+  mark = scheme_stack_top;
+  rands_vec = scheme_alloc_args (num_rands);
   for ( i=0 ; i<num_rands ; ++i )
     {
       rands_vec[i] = SCHEME_CAR (rands);
       rands = SCHEME_CDR (rands);
     }
-  return (scheme_apply (rator, num_rands, rands_vec));
+  val = scheme_apply (rator, num_rands, rands_vec);
+  scheme_reset_stack (mark);
+  return (val);
 }
 
 /* locals */
@@ -289,42 +237,30 @@ procedure_p (int argc, Scheme_Object *argv[])
 static Scheme_Object *
 apply (int argc, Scheme_Object *argv[])
 {
-  Scheme_Object *rands, *rands_last, *pair;
-  Scheme_Object *rand_vec[SCHEME_MAX_ARGS];
+  Scheme_Object *rands, **mark, **rand_vec, *val;
   int i, num_rands;
 
   SCHEME_ASSERT ((argc >= 2), "apply: two argument version only");
   SCHEME_ASSERT (SCHEME_PROCP (argv[0]), "apply: first arg must be a procedure");
-  rands = rands_last = scheme_null;
-  for ( i=1 ; i<(argc-1) ; ++i )
+  rands = argv[argc-1];
+  SCHEME_ASSERT (SCHEME_LISTP (rands), "apply: last arg must be a list");
+  /* the leading args and the list's elements go on the stack
+     together, however long the list is */
+  num_rands = (argc - 2) + scheme_list_length (rands);
+  mark = scheme_stack_top;
+  rand_vec = scheme_alloc_args (num_rands);
+  for ( i=0 ; i<(argc-2) ; ++i )
     {
-      pair = scheme_make_pair (argv[i], scheme_null);
-      if (SCHEME_NULLP (rands))
-	{
-	  rands = rands_last = pair;
-	}
-      else
-	{
-	  SCHEME_CDR (rands_last) = pair;
-	  rands_last = pair;
-	}
+      rand_vec[i] = argv[i+1];
     }
-  SCHEME_ASSERT (SCHEME_LISTP (argv[i]), "apply: last arg must be a list");
-  if (SCHEME_NULLP (rands))
-    {
-      rands = argv[i];
-    }
-  else
-    {
-      SCHEME_CDR (rands_last) = argv[i];
-    }
-  num_rands = scheme_list_length (rands);
-  for ( i=0 ; i<num_rands ; ++i )
+  for ( ; i<num_rands ; ++i )
     {
       rand_vec[i] = SCHEME_CAR (rands);
       rands = SCHEME_CDR (rands);
     }
-  return (scheme_apply (argv[0], num_rands, rand_vec));
+  val = scheme_apply (argv[0], num_rands, rand_vec);
+  scheme_reset_stack (mark);
+  return (val);
 }
 
 static Scheme_Object *map_help (Scheme_Object *fun, Scheme_Object *list);
@@ -424,13 +360,18 @@ static Scheme_Object *
 call_cc (int argc, Scheme_Object *argv[])
 {
   Scheme_Jmpbuf sbuf;
-  Scheme_Object *ret, *cont;
+  Scheme_Object *ret, *cont, **stack;
+  char *mark;
 
   SCHEME_ASSERT ((argc == 1), "call-with-current-continuation: wrong number of args");
   SCHEME_ASSERT (SCHEME_PROCP (argv[0]), 
 		 "call-with-current-continuation: arg must be a procedure");
+  stack = scheme_stack_top;
+  mark = scheme_frame_top;
   if (setjmp (sbuf[0].jmpbuf))
     {
+      scheme_reset_stack (stack);
+      scheme_release_frames (mark);
       return (sbuf[0].obj);
     }
   else
@@ -0,0 +1,531 @@
+/*
+  libscheme
+  Copyright (c) 1994 Brent Benson
+  All rights reserved.
+
+  Permission is hereby granted, without written agreement and without
+  license or royalty fees, to use, copy, modify, and distribute this
+  software and its documentation for any purpose, provided that the
+  above copyright notice and the following two paragraphs appear in
+  all copies of this software.
+
+  IN NO EVENT SHALL BRENT BENSON BE LIABLE TO ANY PARTY FOR DIRECT,
+  INDIRECT, SPECIAL, INCIDENTAL, OR CONSEQUENTIAL DAMAGES ARISING OUT
+  OF THE USE OF THIS SOFTWARE AND ITS DOCUMENTATION, EVEN IF BRENT
+  BENSON HAS BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+  BRENT BENSON SPECIFICALLY DISCLAIMS ANY WARRANTIES, INCLUDING, BUT
+  NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+  FITNESS FOR A PARTICULAR PURPOSE.  THE SOFTWARE PROVIDED HEREUNDER
+  IS ON AN "AS IS" BASIS, AND BRENT BENSON HAS NO OBLIGATION TO
+  PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR
+  MODIFICATIONS.
+*/
+
+
+/* Control of the collector from Scheme.
+
+   With PARALLEL_MARK the collector marks in several threads.  It
+   starts the helper threads when it starts, enough to make the
+   number in GC_MARKERS, or one per processor.  scheme_set_gc_markers
+   sets that number if it is called before scheme_basic_env().  After
+   that it can only change how many of the threads take part in each
+   collection, up to the number started.
+
+   Incremental mode marks a little at a time, with the collector's
+   dirty bits (from page protection) telling it what changed in
+   between, and only stops the world to finish.  It cannot be turned
+   off again.  Every stop of the world is timed, incremental or not,
+   for gc-pause-stats.
+
+   A census collects, then counts what survived by type, telling
+   objects from other blocks as scheme_heap_object_type() does. */
+
+#include "scheme.h"
+#include <string.h>
+#include <limits.h>
+#include <time.h>
+
+#ifdef PARALLEL_MARK
+extern long GC_markers;
+extern int GC_is_initialized;
+extern void *GC_call_with_alloc_lock (void *(*fn) (void *), void *client_data);
+
+static long started_markers;
+static void *set_markers (void *n);
+#endif
+
+#ifndef NO_GC
+/* From the collector's gc.h and gc_priv.h. */
+extern int GC_incremental;
+extern unsigned long GC_time_limit;
+extern void GC_enable_incremental (void);
+extern void (*GC_stop_world_call_back) (void);
+extern void (*GC_start_world_call_back) (void);
+extern unsigned long GC_gc_no;
+extern size_t GC_get_heap_size (void);
+extern size_t GC_get_free_bytes (void);
+extern size_t GC_get_bytes_since_gc (void);
+extern size_t GC_get_total_bytes (void);
+extern void GC_gcollect (void);
+extern int GC_invoke_finalizers (void);
+extern void GC_enumerate_reachable_objects (void (*proc) (void *obj, size_t bytes,
+							  int kind, void *data),
+					    void *client_data);
+#ifndef PARALLEL_MARK
+extern void *GC_call_with_alloc_lock (void *(*fn) (void *), void *client_data);
+#endif
+
+#define GC_TIME_UNLIMITED 999999
+
+/* Only touched with the allocation lock held. */
+static Scheme_GC_Pause_Stats pause_stats;
+static struct timespec pause_start;
+
+static void stop_world (void);
+static void start_world (void);
+static void *copy_pause_stats (void *stats);
+static void *reset_pause_stats (void *stats);
+
+/* Room for this many types in a census; any more count as other. */
+#define CENSUS_SIZE 1024
+
+struct Census_Entry
+{
+  Scheme_Object *type;
+  unsigned long count;
+  unsigned long bytes;
+};
+
+struct Census
+{
+  struct Census_Entry *entries;
+  struct Census_Entry other;
+};
+
+static void census_object (void *obj, size_t bytes, int kind, void *census);
+static int compare_census_entries (const void *a, const void *b);
+static Scheme_Object *make_census_entry (struct Census_Entry *entry);
+#endif
+
+/* locals */
+static Scheme_Object *gc_markers (int argc, Scheme_Object *argv[]);
+static Scheme_Object *gc_collect (int argc, Scheme_Object *argv[]);
+static Scheme_Object *gc_incremental (int argc, Scheme_Object *argv[]);
+static Scheme_Object *gc_pause_stats (int argc, Scheme_Object *argv[]);
+static Scheme_Object *gc_stats (int argc, Scheme_Object *argv[]);
+static Scheme_Object *gc_census (int argc, Scheme_Object *argv[]);
+static Scheme_Object *make_unsigned (unsigned long n);
+
+void
+scheme_init_gc (Scheme_Env *env)
+{
+#ifndef NO_GC
+  GC_stop_world_call_back = stop_world;
+  GC_start_world_call_back = start_world;
+#endif
+  scheme_add_global ("gc-markers", scheme_make_prim (gc_markers), env);
+  scheme_add_global ("gc-collect", scheme_make_prim (gc_collect), env);
+  scheme_add_global ("gc-incremental", scheme_make_prim (gc_incremental), env);
+  scheme_add_global ("gc-pause-stats", scheme_make_prim (gc_pause_stats), env);
+  scheme_add_global ("gc-stats", scheme_make_prim (gc_stats), env);
+  scheme_add_global ("gc-census", scheme_make_prim (gc_census), env);
+}
+
+int
+scheme_gc_markers (void)
+{
+#ifdef PARALLEL_MARK
+  return ((int) GC_markers);
+#else
+  return (1);
+#endif
+}
+
+/* Returns the number of markers that will be used. */
+
+int
+scheme_set_gc_markers (int n)
+{
+#ifdef PARALLEL_MARK
+  char buf[32];
+
+  if (n < 1)
+    {
+      n = 1;
+    }
+  if (! GC_is_initialized)
+    {
+      sprintf (buf, "%d", n);
+      setenv ("GC_MARKERS", buf, 1);
+      return (n);
+    }
+  if (! started_markers)
+    {
+      started_markers = GC_markers;
+    }
+  if (n > started_markers)
+    {
+      n = started_markers;
+    }
+  GC_call_with_alloc_lock (set_markers, &n);
+  return (n);
+#else
+  return (1);
+#endif
+}
+
+/* Collects, then runs the finalizers of whatever was found
+   unreachable, so that they have all run by the time it returns. */
+
+void
+scheme_gc_collect (void)
+{
+#ifndef NO_GC
+  GC_gcollect ();
+  GC_invoke_finalizers ();
+#endif
+}
+
+int
+scheme_gc_incremental (void)
+{
+#ifndef NO_GC
+  return (GC_incremental);
+#else
+  return (0);
+#endif
+}
+
+/* Switches to incremental collection, trying to keep each stop of
+   the world under pause_msecs.  With 0 the collector is only
+   generational: it still uses the dirty bits to mark just what
+   changed, but always finishes a collection once started.  Returns
+   whether the collector is now incremental. */
+
+int
+scheme_set_gc_incremental (unsigned long pause_msecs)
+{
+#ifndef NO_GC
+  GC_time_limit = (pause_msecs ? pause_msecs : GC_TIME_UNLIMITED);
+  GC_enable_incremental ();
+  return (GC_incremental);
+#else
+  return (0);
+#endif
+}
+
+/* Copies the pause statistics into stats, clearing them afterwards
+   if reset is nonzero. */
+
+void
+scheme_gc_pause_stats (Scheme_GC_Pause_Stats *stats, int reset)
+{
+#ifndef NO_GC
+  GC_call_with_alloc_lock (copy_pause_stats, stats);
+  if (reset)
+    {
+      GC_call_with_alloc_lock (reset_pause_stats, NULL);
+    }
+#else
+  memset (stats, 0, sizeof (Scheme_GC_Pause_Stats));
+#endif
+}
+
+void
+scheme_gc_stats (Scheme_GC_Stats *stats)
+{
+#ifndef NO_GC
+  stats->collections = GC_gc_no;
+  stats->heap_bytes = GC_get_heap_size ();
+  stats->free_bytes = GC_get_free_bytes ();
+  stats->bytes_since_gc = GC_get_bytes_since_gc ();
+  stats->total_bytes = GC_get_total_bytes ();
+#else
+  memset (stats, 0, sizeof (Scheme_GC_Stats));
+#endif
+}
+
+/* Collects, and returns a list with an entry (name count bytes) for
+   each type with live objects, largest first.  An entry whose name
+   is #f counts the blocks that are not objects, such as the storage
+   of strings. */
+
+Scheme_Object *
+scheme_gc_census (void)
+{
+#ifndef NO_GC
+  struct Census census;
+  Scheme_Object *result;
+  int i, n;
+
+  census.entries = (struct Census_Entry *)
+    scheme_calloc (CENSUS_SIZE + 1, sizeof (struct Census_Entry));
+  memset (&census.other, 0, sizeof (struct Census_Entry));
+  GC_gcollect ();
+  GC_enumerate_reachable_objects (census_object, &census);
+  for ( i=n=0 ; i<CENSUS_SIZE ; ++i )
+    {
+      if (census.entries[i].type)
+	{
+	  census.entries[n++] = census.entries[i];
+	}
+    }
+  census.entries[n++] = census.other;
+  qsort (census.entries, n, sizeof (struct Census_Entry), compare_census_entries);
+  result = scheme_null;
+  while (n--)
+    {
+      result = scheme_make_pair (make_census_entry (&census.entries[n]), result);
+    }
+  return (result);
+#else
+  return (scheme_null);
+#endif
+}
+
+/* locals */
+
+#ifndef NO_GC
+static void
+stop_world (void)
+{
+  clock_gettime (CLOCK_MONOTONIC, &pause_start);
+}
+
+static void
+start_world (void)
+{
+  struct timespec now;
+  unsigned long usecs;
+  int i;
+
+  clock_gettime (CLOCK_MONOTONIC, &now);
+  usecs = ((now.tv_sec - pause_start.tv_sec) * 1000000
+	   + (now.tv_nsec - pause_start.tv_nsec) / 1000);
+  pause_stats.count++;
+  pause_stats.total_usecs += usecs;
+  if (usecs > pause_stats.max_usecs)
+    {
+      pause_stats.max_usecs = usecs;
+    }
+  for (i = 0; i < SCHEME_GC_PAUSE_BUCKETS - 1; ++i)
+    {
+      if (usecs < (1UL << i))
+	{
+	  break;
+	}
+    }
+  pause_stats.histogram[i]++;
+}
+
+static void *
+copy_pause_stats (void *stats)
+{
+  memcpy (stats, &pause_stats, sizeof (Scheme_GC_Pause_Stats));
+  return (NULL);
+}
+
+static void *
+reset_pause_stats (void *stats)
+{
+  memset (&pause_stats, 0, sizeof (Scheme_GC_Pause_Stats));
+  return (NULL);
+}
+
+/* Runs with the allocation lock held, so it must not allocate. */
+
+static void
+census_object (void *obj, size_t bytes, int kind, void *census)
+{
+  struct Census *c = (struct Census *) census;
+  struct Census_Entry *entry;
+  Scheme_Object *type;
+  int i, probes;
+
+  type = scheme_heap_object_type (obj, bytes, kind);
+  entry = &c->other;
+  if (type)
+    {
+      i = ((uintptr_t) type >> 3) & (CENSUS_SIZE - 1);
+      for ( probes=0 ; probes<CENSUS_SIZE ; ++probes )
+	{
+	  if (c->entries[i].type == type || ! c->entries[i].type)
+	    {
+	      entry = &c->entries[i];
+	      entry->type = type;
+	      break;
+	    }
+	  i = (i + 1) & (CENSUS_SIZE - 1);
+	}
+    }
+  entry->count++;
+  entry->bytes += bytes;
+}
+
+static int
+compare_census_entries (const void *a, const void *b)
+{
+  unsigned long abytes = ((struct Census_Entry *) a)->bytes;
+  unsigned long bbytes = ((struct Census_Entry *) b)->bytes;
+
+  return (abytes < bbytes ? 1 : abytes > bbytes ? -1 : 0);
+}
+
+static Scheme_Object *
+make_census_entry (struct Census_Entry *entry)
+{
+  Scheme_Object *name;
+
+  name = (entry->type
+	  ? scheme_intern_symbol (SCHEME_STR_VAL (entry->type))
+	  : scheme_false);
+  return (scheme_make_pair (name,
+			    scheme_make_pair (make_unsigned (entry->count),
+					      scheme_make_pair (make_unsigned (entry->bytes),
+								scheme_null))));
+}
+#endif
+
+#ifdef PARALLEL_MARK
+static void *
+set_markers (void *n)
+{
+  GC_markers = *(int *) n;
+  return (NULL);
+}
+#endif
+
+/* Counts and byte totals can pass INT_MAX, beyond a fixnum, and are
+   returned as doubles from there. */
+
+static Scheme_Object *
+make_unsigned (unsigned long n)
+{
+  if (n <= INT_MAX)
+    {
+      return (scheme_make_integer ((int) n));
+    }
+  return (scheme_make_double ((double) n));
+}
+
+/* (gc-markers [n]) returns the number of threads that mark, after
+   setting it to n if given. */
+
+static Scheme_Object *
+gc_markers (int argc, Scheme_Object *argv[])
+{
+  SCHEME_ASSERT ((argc == 0 || argc == 1), "gc-markers: wrong number of args");
+  if (argc == 1)
+    {
+      SCHEME_ASSERT (SCHEME_INTP (argv[0]), "gc-markers: arg must be an integer");
+      return (scheme_make_integer (scheme_set_gc_markers (SCHEME_INT_VAL (argv[0]))));
+    }
+  return (scheme_make_integer (scheme_gc_markers ()));
+}
+
+/* (gc-collect) collects and runs the finalizers that are due; see
+   scheme_gc_collect(). */
+
+static Scheme_Object *
+gc_collect (int argc, Scheme_Object *argv[])
+{
+  SCHEME_ASSERT ((argc == 0), "gc-collect: wrong number of args");
+  scheme_gc_collect ();
+  return (scheme_true);
+}
+
+/* (gc-incremental [pause-msecs]) returns whether the collector is
+   incremental, after switching to incremental collection with the
+   given pause target if one is given. */
+
+static Scheme_Object *
+gc_incremental (int argc, Scheme_Object *argv[])
+{
+  int on;
+
+  SCHEME_ASSERT ((argc == 0 || argc == 1), "gc-incremental: wrong number of args");
+  if (argc == 1)
+    {
+      SCHEME_ASSERT ((SCHEME_INTP (argv[0]) && SCHEME_INT_VAL (argv[0]) >= 0),
+		     "gc-incremental: arg must be a non-negative integer");
+      on = scheme_set_gc_incremental (SCHEME_INT_VAL (argv[0]));
+    }
+  else
+    {
+      on = scheme_gc_incremental ();
+    }
+  return (on ? scheme_true : scheme_false);
+}
+
+/* (gc-pause-stats [reset?]) returns an association list of the
+   count, total and longest of the pauses so far, in microseconds,
+   with a vector histogram of them, bucketed by powers of two. */
+
+static Scheme_Object *
+gc_pause_stats (int argc, Scheme_Object *argv[])
+{
+  Scheme_GC_Pause_Stats stats;
+  Scheme_Object *hist, *result;
+  int i;
+
+  SCHEME_ASSERT ((argc == 0 || argc == 1), "gc-pause-stats: wrong number of args");
+  scheme_gc_pause_stats (&stats, (argc == 1 && argv[0] != scheme_false));
+  hist = scheme_make_vector (SCHEME_GC_PAUSE_BUCKETS, scheme_make_integer (0));
+  for (i = 0; i < SCHEME_GC_PAUSE_BUCKETS; ++i)
+    {
+      SCHEME_VEC_ELS (hist)[i] = make_unsigned (stats.histogram[i]);
+    }
+  result = scheme_make_pair (scheme_make_pair (scheme_intern_symbol ("histogram"), hist),
+			     scheme_null);
+  result = scheme_make_pair (scheme_make_pair (scheme_intern_symbol ("max"),
+					       make_unsigned (stats.max_usecs)),
+			     result);
+  result = scheme_make_pair (scheme_make_pair (scheme_intern_symbol ("total"),
+					       make_unsigned (stats.total_usecs)),
+			     result);
+  result = scheme_make_pair (scheme_make_pair (scheme_intern_symbol ("count"),
+					       make_unsigned (stats.count)),
+			     result);
+  return (result);
+}
+
+/* (gc-stats) returns an association list of the number of
+   collections, the heap size, a lower bound on its free bytes, the
+   bytes allocated since the last collection and in all. */
+
+static Scheme_Object *
+gc_stats (int argc, Scheme_Object *argv[])
+{
+  Scheme_GC_Stats stats;
+  Scheme_Object *result;
+
+  SCHEME_ASSERT ((argc == 0), "gc-stats: wrong number of args");
+  scheme_gc_stats (&stats);
+  result = scheme_make_pair (scheme_make_pair (scheme_intern_symbol ("total-bytes"),
+					       make_unsigned (stats.total_bytes)),
+			     scheme_null);
+  result = scheme_make_pair (scheme_make_pair (scheme_intern_symbol ("bytes-since-gc"),
+					       make_unsigned (stats.bytes_since_gc)),
+			     result);
+  result = scheme_make_pair (scheme_make_pair (scheme_intern_symbol ("free-bytes"),
+					       make_unsigned (stats.free_bytes)),
+			     result);
+  result = scheme_make_pair (scheme_make_pair (scheme_intern_symbol ("heap-bytes"),
+					       make_unsigned (stats.heap_bytes)),
+			     result);
+  result = scheme_make_pair (scheme_make_pair (scheme_intern_symbol ("collections"),
+					       make_unsigned (stats.collections)),
+			     result);
+  return (result);
+}
+
+/* (gc-census) collects and returns a list of (name count bytes) for
+   the live objects of each type; see scheme_gc_census(). */
+
+static Scheme_Object *
+gc_census (int argc, Scheme_Object *argv[])
+{
+  SCHEME_ASSERT ((argc == 0), "gc-census: wrong number of args");
+  return (scheme_gc_census ());
+}
@@ -123,3 +123,168 @@ scheme_hash (char *key)
     }
   return (h);
 }
+
+/* Weak tables.  Keys are hashed by address, hidden, so the hash of
+   a bucket can be taken from its hidden key alone. */
+
+#define WEAK_HASH(hidden, size) ((unsigned int) (((uintptr_t) (hidden) >> 2) % (size)))
+
+static Scheme_Weak_Bucket **weak_chain (Scheme_Weak_Table *table, void *hidden);
+static void prune_chain (Scheme_Weak_Table *table, Scheme_Weak_Bucket **chain);
+static void grow_weak_table (Scheme_Weak_Table *table);
+
+Scheme_Weak_Table *
+scheme_weak_table (int size)
+{
+  Scheme_Weak_Table *table;
+
+  table = (Scheme_Weak_Table *) scheme_malloc (sizeof (Scheme_Weak_Table));
+  table->size = size;
+  table->count = 0;
+  table->buckets = (Scheme_Weak_Bucket **) scheme_calloc (size, sizeof (Scheme_Weak_Bucket *));
+  return (table);
+}
+
+/* Adds key to table, or changes its value if it is there. */
+
+void
+scheme_add_to_weak_table (Scheme_Weak_Table *table, Scheme_Object *key, void *val)
+{
+  Scheme_Weak_Bucket **chain, *bucket;
+  void *hidden;
+
+  hidden = SCHEME_HIDE_POINTER (key);
+  chain = weak_chain (table, hidden);
+  for ( bucket = *chain ; bucket ; bucket = bucket->next )
+    {
+      if (bucket->key == hidden)
+	{
+	  bucket->val = val;
+	  return;
+	}
+    }
+  bucket = (Scheme_Weak_Bucket *) scheme_malloc (sizeof (Scheme_Weak_Bucket));
+  bucket->key = hidden;
+  bucket->val = val;
+  bucket->next = *chain;
+  *chain = bucket;
+  scheme_weak_link (&bucket->key, key);
+  if (++table->count > 2 * table->size)
+    {
+      grow_weak_table (table);
+    }
+}
+
+void *
+scheme_lookup_in_weak_table (Scheme_Weak_Table *table, Scheme_Object *key)
+{
+  Scheme_Weak_Bucket *bucket;
+  void *hidden;
+
+  hidden = SCHEME_HIDE_POINTER (key);
+  for ( bucket = *weak_chain (table, hidden) ; bucket ; bucket = bucket->next )
+    {
+      if (bucket->key == hidden)
+	{
+	  return (bucket->val);
+	}
+    }
+  return (NULL);
+}
+
+void
+scheme_remove_from_weak_table (Scheme_Weak_Table *table, Scheme_Object *key)
+{
+  Scheme_Weak_Bucket **chain, *bucket;
+  void *hidden;
+
+  hidden = SCHEME_HIDE_POINTER (key);
+  for ( chain = weak_chain (table, hidden) ; (bucket = *chain) ; chain = &bucket->next )
+    {
+      if (bucket->key == hidden)
+	{
+	  scheme_weak_unlink (&bucket->key);
+	  *chain = bucket->next;
+	  table->count--;
+	  return;
+	}
+    }
+}
+
+/* The number of keys still in table, after dropping the buckets of
+   those that the collector has cleared. */
+
+int
+scheme_weak_table_count (Scheme_Weak_Table *table)
+{
+  int i;
+
+  for ( i=0 ; i<table->size ; ++i )
+    {
+      prune_chain (table, &table->buckets[i]);
+    }
+  return (table->count);
+}
+
+/* The chain that hidden would be in, pruned. */
+
+static Scheme_Weak_Bucket **
+weak_chain (Scheme_Weak_Table *table, void *hidden)
+{
+  Scheme_Weak_Bucket **chain;
+
+  chain = &table->buckets[WEAK_HASH (hidden, table->size)];
+  prune_chain (table, chain);
+  return (chain);
+}
+
+/* Drops the buckets whose keys the collector has cleared. */
+
+static void
+prune_chain (Scheme_Weak_Table *table, Scheme_Weak_Bucket **bucket)
+{
+  while ( *bucket )
+    {
+      if ((*bucket)->key)
+	{
+	  bucket = &(*bucket)->next;
+	}
+      else
+	{
+	  *bucket = (*bucket)->next;
+	  table->count--;
+	}
+    }
+}
+
+/* The buckets move to a table twice the size; their keys stay where
+   they were, so the collector's links to them still hold. */
+
+static void
+grow_weak_table (Scheme_Weak_Table *table)
+{
+  Scheme_Weak_Bucket **old, *bucket, *next;
+  int old_size, i;
+  unsigned int h;
+
+  old = table->buckets;
+  old_size = table->size;
+  table->size = 2 * old_size + 1;
+  table->buckets = (Scheme_Weak_Bucket **)
+    scheme_calloc (table->size, sizeof (Scheme_Weak_Bucket *));
+  table->count = 0;
+  for ( i=0 ; i<old_size ; ++i )
+    {
+      for ( bucket = old[i] ; bucket ; bucket = next )
+	{
+	  next = bucket->next;
+	  if (bucket->key)
+	    {
+	      h = WEAK_HASH (bucket->key, table->size);
+	      bucket->next = table->buckets[h];
+	      table->buckets[h] = bucket;
+	      table->count++;
+	    }
+	}
+    }
+}
@@ -25,11 +25,9 @@
 #include "scheme.h"
 
 /* globals */
-Scheme_Object *scheme_null;
 Scheme_Object *scheme_null_type, *scheme_pair_type;
 
 /* locals */
-static Scheme_Object *scheme_make_null (void);
 static Scheme_Object *pair_p_prim (int argc, Scheme_Object *argv[]);
 static Scheme_Object *cons_prim (int argc, Scheme_Object *argv[]);
 static Scheme_Object *car_prim (int argc, Scheme_Object *argv[]);
@@ -68,8 +66,9 @@ scheme_init_list (Scheme_Env *env)
 {
   scheme_null_type = scheme_make_type ("<empty-list>");
   scheme_add_global ("<empty-list>", scheme_null_type, env);
-  scheme_null = scheme_make_null ();
+  scheme_set_tag_type (scheme_null, 5, scheme_null_type);
   scheme_pair_type = scheme_make_type ("<pair>");
+  scheme_set_tag_type (scheme_make_pair (scheme_null, scheme_null), 3, scheme_pair_type);
   scheme_add_global ("<pair>", scheme_pair_type, env);
   scheme_add_global ("pair?", scheme_make_prim (pair_p_prim), env);
   scheme_add_global ("cons", scheme_make_prim (cons_prim), env);
@@ -105,23 +104,12 @@ scheme_init_list (Scheme_Env *env)
   scheme_add_global ("cdddr", scheme_make_prim (cdddr_prim), env);
 }
 
-static Scheme_Object *
-scheme_make_null (void)
-{
-  Scheme_Object *null;
-
-  null = scheme_alloc_object ();
-  SCHEME_TYPE (null) = scheme_null_type;
-  return (null);
-}
-
 Scheme_Object *
 scheme_make_pair (Scheme_Object *car, Scheme_Object *cdr)
 {
   Scheme_Object *cons;
 
-  cons = scheme_alloc_object ();
-  SCHEME_TYPE(cons) = scheme_pair_type;
+  cons = (Scheme_Object *) ((char *) scheme_alloc_cell () + 4);
   SCHEME_CAR(cons) = car;
   SCHEME_CDR(cons) = cdr;
   return (cons);
@@ -82,6 +82,7 @@ void
 scheme_init_number (Scheme_Env *env)
 {
   scheme_integer_type = scheme_make_type ("<integer>");
+  scheme_set_tag_type (scheme_make_integer (0), 1, scheme_integer_type);
   scheme_double_type = scheme_make_type ("<double>");
   scheme_add_global ("<integer>", scheme_integer_type, env);
   scheme_add_global ("<double>", scheme_double_type, env);
@@ -134,24 +135,13 @@ scheme_init_number (Scheme_Env *env)
 }
 
 
-Scheme_Object *
-scheme_make_integer (int i)
-{
-  Scheme_Object *si;
-
-  si = scheme_alloc_object ();
-  SCHEME_TYPE (si) = scheme_integer_type;
-  SCHEME_INT_VAL (si) = i;
-  return (si);
-}
-
 Scheme_Object *
 scheme_make_double (double d)
 {
   Scheme_Object *sd;
 
-  sd = scheme_alloc_object ();
-  SCHEME_TYPE (sd) = scheme_double_type;
+  sd = scheme_alloc_atomic_object ();
+  _SCHEME_TYPE (sd) = scheme_double_type;
   SCHEME_DBL_VAL (sd) = d;
   return (sd);
 }
@@ -613,7 +603,7 @@ bin_lcm (Scheme_Object *n1, Scheme_Object *n2)
     }
   if (SCHEME_INTP (ret))
     {
-      SCHEME_INT_VAL(ret) = ABS (SCHEME_INT_VAL(ret));
+      ret = scheme_make_integer (ABS (SCHEME_INT_VAL(ret)));
     }
   return (ret);
 }
@@ -855,7 +845,7 @@ string_to_number (int argc, Scheme_Object *argv[])
       base = 10;
     }
   str = SCHEME_STR_VAL (argv[0]);
-  len = strlen (str);
+  len = SCHEME_STR_LEN (argv[0]);
   if (! len)
     {
       return (scheme_false);
@@ -0,0 +1,1129 @@
+/*
+  libscheme
+  Copyright (c) 1994 Brent Benson
+  All rights reserved.
+
+  Permission is hereby granted, without written agreement and without
+  license or royalty fees, to use, copy, modify, and distribute this
+  software and its documentation for any purpose, provided that the
+  above copyright notice and the following two paragraphs appear in
+  all copies of this software.
+
+  IN NO EVENT SHALL BRENT BENSON BE LIABLE TO ANY PARTY FOR DIRECT,
+  INDIRECT, SPECIAL, INCIDENTAL, OR CONSEQUENTIAL DAMAGES ARISING OUT
+  OF THE USE OF THIS SOFTWARE AND ITS DOCUMENTATION, EVEN IF BRENT
+  BENSON HAS BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+  BRENT BENSON SPECIFICALLY DISCLAIMS ANY WARRANTIES, INCLUDING, BUT
+  NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+  FITNESS FOR A PARTICULAR PURPOSE.  THE SOFTWARE PROVIDED HEREUNDER
+  IS ON AN "AS IS" BASIS, AND BRENT BENSON HAS NO OBLIGATION TO
+  PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR
+  MODIFICATIONS.
+*/
+
+/* Homogeneous numeric vectors, as in SRFI 4: u8vectors, s32vectors
+   and f64vectors.  The elements are stored unboxed after the object
+   in one block that the collector does not scan.  Besides the usual
+   operations each type has bulk ones (sum, dot, scale!, add!, min,
+   max), which use SSE2 where the compiler offers it.
+
+   A bytevector is a u8vector under its R7RS names, with accessors
+   for wider integers and doubles at any offset in either byte
+   order. */
+
+#include "scheme.h"
+#include <string.h>
+#include <limits.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/* globals */
+Scheme_Object *scheme_u8vector_type;
+Scheme_Object *scheme_s32vector_type;
+Scheme_Object *scheme_f64vector_type;
+
+/* locals */
+static Scheme_Object *big_symbol, *little_symbol;
+
+static Scheme_Object *make_int64 (int64_t n);
+static Scheme_Object *make_uint64 (uint64_t n);
+
+static Scheme_Object *bytevector_copy_x (int argc, Scheme_Object *argv[]);
+static Scheme_Object *utf8_to_string (int argc, Scheme_Object *argv[]);
+static Scheme_Object *string_to_utf8 (int argc, Scheme_Object *argv[]);
+static Scheme_Object *bytevector_u16_ref (int argc, Scheme_Object *argv[]);
+static Scheme_Object *bytevector_u16_set (int argc, Scheme_Object *argv[]);
+static Scheme_Object *bytevector_u32_ref (int argc, Scheme_Object *argv[]);
+static Scheme_Object *bytevector_u32_set (int argc, Scheme_Object *argv[]);
+static Scheme_Object *bytevector_u64_ref (int argc, Scheme_Object *argv[]);
+static Scheme_Object *bytevector_u64_set (int argc, Scheme_Object *argv[]);
+static Scheme_Object *bytevector_f64_ref (int argc, Scheme_Object *argv[]);
+static Scheme_Object *bytevector_f64_set (int argc, Scheme_Object *argv[]);
+
+static int64_t u8_sum (unsigned char *els, int n);
+static int64_t u8_dot (unsigned char *els1, unsigned char *els2, int n);
+static void u8_scale (unsigned char *els, int n, int k);
+static void u8_add (unsigned char *dst, unsigned char *src, int n);
+static int u8_min (unsigned char *els, int n);
+static int u8_max (unsigned char *els, int n);
+
+static int64_t s32_sum (int32_t *els, int n);
+static int64_t s32_dot (int32_t *els1, int32_t *els2, int n);
+static void s32_scale (int32_t *els, int n, int k);
+static void s32_add (int32_t *dst, int32_t *src, int n);
+static int32_t s32_min (int32_t *els, int n);
+static int32_t s32_max (int32_t *els, int n);
+
+static double f64_sum (double *els, int n);
+static double f64_dot (double *els1, double *els2, int n);
+static void f64_scale (double *els, int n, double k);
+static void f64_add (double *dst, double *src, int n);
+static double f64_min (double *els, int n);
+static double f64_max (double *els, int n);
+
+/* how each type takes elements from and gives them to Scheme */
+
+#define U8_CHECK(obj)	(SCHEME_INTP (obj) \
+			 && SCHEME_INT_VAL (obj) >= 0 && SCHEME_INT_VAL (obj) <= 255)
+#define U8_FROM(obj)	((unsigned char) SCHEME_INT_VAL (obj))
+#define U8_TO(x)	(scheme_make_integer (x))
+#define U8_SCALAR	SCHEME_INTP
+#define U8_SCALAR_VAL	SCHEME_INT_VAL
+#define U8_ACC_TO	make_int64
+
+#define S32_CHECK(obj)	SCHEME_INTP (obj)
+#define S32_FROM(obj)	((int32_t) SCHEME_INT_VAL (obj))
+#define S32_TO(x)	(scheme_make_integer (x))
+#define S32_SCALAR	SCHEME_INTP
+#define S32_SCALAR_VAL	SCHEME_INT_VAL
+#define S32_ACC_TO	make_int64
+
+#define F64_CHECK(obj)	SCHEME_NUMBERP (obj)
+#define F64_FROM(obj)	(SCHEME_INTP (obj) \
+			 ? (double) SCHEME_INT_VAL (obj) : SCHEME_DBL_VAL (obj))
+#define F64_TO(x)	(scheme_make_double (x))
+#define F64_SCALAR	SCHEME_NUMBERP
+#define F64_SCALAR_VAL	F64_FROM
+#define F64_ACC_TO	scheme_make_double
+
+/* The primitives are the same for each type but for the element type
+   and the conversions above; GEN_NUMVEC makes a set of them. */
+
+#define GEN_NUMVEC_PROT(tag) \
+static Scheme_Object *tag##vector_p (int argc, Scheme_Object *argv[]); \
+static Scheme_Object *make_##tag##vector (int argc, Scheme_Object *argv[]); \
+static Scheme_Object *tag##vector (int argc, Scheme_Object *argv[]); \
+static Scheme_Object *tag##vector_length (int argc, Scheme_Object *argv[]); \
+static Scheme_Object *tag##vector_ref (int argc, Scheme_Object *argv[]); \
+static Scheme_Object *tag##vector_set (int argc, Scheme_Object *argv[]); \
+static Scheme_Object *tag##vector_to_list (int argc, Scheme_Object *argv[]); \
+static Scheme_Object *list_to_##tag##vector (int argc, Scheme_Object *argv[]); \
+static Scheme_Object *tag##vector_fill (int argc, Scheme_Object *argv[]); \
+static Scheme_Object *tag##vector_copy (int argc, Scheme_Object *argv[]); \
+static Scheme_Object *tag##vector_sum (int argc, Scheme_Object *argv[]); \
+static Scheme_Object *tag##vector_dot (int argc, Scheme_Object *argv[]); \
+static Scheme_Object *tag##vector_scale (int argc, Scheme_Object *argv[]); \
+static Scheme_Object *tag##vector_add (int argc, Scheme_Object *argv[]); \
+static Scheme_Object *tag##vector_min (int argc, Scheme_Object *argv[]); \
+static Scheme_Object *tag##vector_max (int argc, Scheme_Object *argv[])
+
+#define GEN_NUMVEC_INIT(tag, env) \
+  scheme_add_global (#tag "vector?", scheme_make_prim (tag##vector_p), env); \
+  scheme_add_global ("make-" #tag "vector", scheme_make_prim (make_##tag##vector), env); \
+  scheme_add_global (#tag "vector", scheme_make_prim (tag##vector), env); \
+  scheme_add_global (#tag "vector-length", scheme_make_prim (tag##vector_length), env); \
+  scheme_add_global (#tag "vector-ref", scheme_make_prim (tag##vector_ref), env); \
+  scheme_add_global (#tag "vector-set!", scheme_make_prim (tag##vector_set), env); \
+  scheme_add_global (#tag "vector->list", scheme_make_prim (tag##vector_to_list), env); \
+  scheme_add_global ("list->" #tag "vector", scheme_make_prim (list_to_##tag##vector), env); \
+  scheme_add_global (#tag "vector-fill!", scheme_make_prim (tag##vector_fill), env); \
+  scheme_add_global (#tag "vector-copy", scheme_make_prim (tag##vector_copy), env); \
+  scheme_add_global (#tag "vector-sum", scheme_make_prim (tag##vector_sum), env); \
+  scheme_add_global (#tag "vector-dot", scheme_make_prim (tag##vector_dot), env); \
+  scheme_add_global (#tag "vector-scale!", scheme_make_prim (tag##vector_scale), env); \
+  scheme_add_global (#tag "vector-add!", scheme_make_prim (tag##vector_add), env); \
+  scheme_add_global (#tag "vector-min", scheme_make_prim (tag##vector_min), env); \
+  scheme_add_global (#tag "vector-max", scheme_make_prim (tag##vector_max), env)
+
+#define GEN_NUMVEC(tag, TAG, ctype) \
+static Scheme_Object * \
+tag##vector_p (int argc, Scheme_Object *argv[]) \
+{ \
+  SCHEME_ASSERT ((argc == 1), #tag "vector?: wrong number of args"); \
+  return (SCHEME_##TAG##VECTORP (argv[0]) ? scheme_true : scheme_false); \
+} \
+\
+static Scheme_Object * \
+make_##tag##vector (int argc, Scheme_Object *argv[]) \
+{ \
+  Scheme_Object *vec; \
+  ctype fill, *els; \
+  int len, i; \
+\
+  SCHEME_ASSERT ((argc == 1 || argc == 2), "make-" #tag "vector: wrong number of args"); \
+  SCHEME_ASSERT (SCHEME_INTP (argv[0]) && SCHEME_INT_VAL (argv[0]) >= 0, \
+		 "make-" #tag "vector: first arg must be a non-negative integer"); \
+  len = SCHEME_INT_VAL (argv[0]); \
+  fill = 0; \
+  if (argc == 2) \
+    { \
+      SCHEME_ASSERT (TAG##_CHECK (argv[1]), "make-" #tag "vector: bad fill value"); \
+      fill = TAG##_FROM (argv[1]); \
+    } \
+  vec = scheme_alloc_numvec (scheme_##tag##vector_type, len, sizeof (ctype)); \
+  els = SCHEME_##TAG##VEC_ELS (vec); \
+  for ( i=0 ; i<len ; ++i ) \
+    { \
+      els[i] = fill; \
+    } \
+  return (vec); \
+} \
+\
+static Scheme_Object * \
+tag##vector (int argc, Scheme_Object *argv[]) \
+{ \
+  Scheme_Object *vec; \
+  int i; \
+\
+  vec = scheme_alloc_numvec (scheme_##tag##vector_type, argc, sizeof (ctype)); \
+  for ( i=0 ; i<argc ; ++i ) \
+    { \
+      SCHEME_ASSERT (TAG##_CHECK (argv[i]), #tag "vector: bad element"); \
+      SCHEME_##TAG##VEC_ELS (vec)[i] = TAG##_FROM (argv[i]); \
+    } \
+  return (vec); \
+} \
+\
+static Scheme_Object * \
+tag##vector_length (int argc, Scheme_Object *argv[]) \
+{ \
+  SCHEME_ASSERT ((argc == 1), #tag "vector-length: wrong number of args"); \
+  SCHEME_ASSERT (SCHEME_##TAG##VECTORP (argv[0]), \
+		 #tag "vector-length: arg must be a " #tag "vector"); \
+  return (scheme_make_integer (SCHEME_NUMVEC_SIZE (argv[0]))); \
+} \
+\
+static Scheme_Object * \
+tag##vector_ref (int argc, Scheme_Object *argv[]) \
+{ \
+  int i; \
+\
+  SCHEME_ASSERT ((argc == 2), #tag "vector-ref: wrong number of args"); \
+  SCHEME_ASSERT (SCHEME_##TAG##VECTORP (argv[0]), \
+		 #tag "vector-ref: first arg must be a " #tag "vector"); \
+  SCHEME_ASSERT (SCHEME_INTP (argv[1]), #tag "vector-ref: second arg must be an integer"); \
+  i = SCHEME_INT_VAL (argv[1]); \
+  SCHEME_ASSERT ((i >= 0) && (i < SCHEME_NUMVEC_SIZE (argv[0])), \
+		 #tag "vector-ref: index out of range"); \
+  return (TAG##_TO (SCHEME_##TAG##VEC_ELS (argv[0])[i])); \
+} \
+\
+static Scheme_Object * \
+tag##vector_set (int argc, Scheme_Object *argv[]) \
+{ \
+  int i; \
+\
+  SCHEME_ASSERT ((argc == 3), #tag "vector-set!: wrong number of args"); \
+  SCHEME_ASSERT (SCHEME_##TAG##VECTORP (argv[0]), \
+		 #tag "vector-set!: first arg must be a " #tag "vector"); \
+  SCHEME_ASSERT (SCHEME_INTP (argv[1]), #tag "vector-set!: second arg must be an integer"); \
+  SCHEME_ASSERT (TAG##_CHECK (argv[2]), #tag "vector-set!: bad element"); \
+  i = SCHEME_INT_VAL (argv[1]); \
+  SCHEME_ASSERT ((i >= 0) && (i < SCHEME_NUMVEC_SIZE (argv[0])), \
+		 #tag "vector-set!: index out of range"); \
+  SCHEME_##TAG##VEC_ELS (argv[0])[i] = TAG##_FROM (argv[2]); \
+  return (argv[0]); \
+} \
+\
+static Scheme_Object * \
+tag##vector_to_list (int argc, Scheme_Object *argv[]) \
+{ \
+  Scheme_Object *list; \
+  int i; \
+\
+  SCHEME_ASSERT ((argc == 1), #tag "vector->list: wrong number of args"); \
+  SCHEME_ASSERT (SCHEME_##TAG##VECTORP (argv[0]), \
+		 #tag "vector->list: arg must be a " #tag "vector"); \
+  list = scheme_null; \
+  for ( i=SCHEME_NUMVEC_SIZE (argv[0])-1 ; i>=0 ; --i ) \
+    { \
+      list = scheme_make_pair (TAG##_TO (SCHEME_##TAG##VEC_ELS (argv[0])[i]), list); \
+    } \
+  return (list); \
+} \
+\
+static Scheme_Object * \
+list_to_##tag##vector (int argc, Scheme_Object *argv[]) \
+{ \
+  Scheme_Object *vec, *list; \
+  int i; \
+\
+  SCHEME_ASSERT ((argc == 1), "list->" #tag "vector: wrong number of args"); \
+  SCHEME_ASSERT (SCHEME_LISTP (argv[0]), "list->" #tag "vector: arg must be a list"); \
+  vec = scheme_alloc_numvec (scheme_##tag##vector_type, \
+			     scheme_list_length (argv[0]), sizeof (ctype)); \
+  list = argv[0]; \
+  for ( i=0 ; ! SCHEME_NULLP (list) ; ++i ) \
+    { \
+      SCHEME_ASSERT (TAG##_CHECK (SCHEME_CAR (list)), "list->" #tag "vector: bad element"); \
+      SCHEME_##TAG##VEC_ELS (vec)[i] = TAG##_FROM (SCHEME_CAR (list)); \
+      list = SCHEME_CDR (list); \
+    } \
+  return (vec); \
+} \
+\
+static Scheme_Object * \
+tag##vector_fill (int argc, Scheme_Object *argv[]) \
+{ \
+  ctype fill, *els; \
+  int len, i; \
+\
+  SCHEME_ASSERT ((argc == 2), #tag "vector-fill!: wrong number of args"); \
+  SCHEME_ASSERT (SCHEME_##TAG##VECTORP (argv[0]), \
+		 #tag "vector-fill!: first arg must be a " #tag "vector"); \
+  SCHEME_ASSERT (TAG##_CHECK (argv[1]), #tag "vector-fill!: bad fill value"); \
+  fill = TAG##_FROM (argv[1]); \
+  els = SCHEME_##TAG##VEC_ELS (argv[0]); \
+  len = SCHEME_NUMVEC_SIZE (argv[0]); \
+  for ( i=0 ; i<len ; ++i ) \
+    { \
+      els[i] = fill; \
+    } \
+  return (argv[0]); \
+} \
+\
+static Scheme_Object * \
+tag##vector_copy (int argc, Scheme_Object *argv[]) \
+{ \
+  Scheme_Object *vec; \
+  int start, end; \
+\
+  SCHEME_ASSERT ((argc >= 1 && argc <= 3), #tag "vector-copy: wrong number of args"); \
+  SCHEME_ASSERT (SCHEME_##TAG##VECTORP (argv[0]), \
+		 #tag "vector-copy: first arg must be a " #tag "vector"); \
+  scheme_numvec_range (#tag "vector-copy", argv[0], argc, argv, 1, &start, &end); \
+  vec = scheme_alloc_numvec (scheme_##tag##vector_type, end - start, sizeof (ctype)); \
+  memcpy (SCHEME_##TAG##VEC_ELS (vec), SCHEME_##TAG##VEC_ELS (argv[0]) + start, \
+	  (end - start) * sizeof (ctype)); \
+  return (vec); \
+} \
+\
+static Scheme_Object * \
+tag##vector_sum (int argc, Scheme_Object *argv[]) \
+{ \
+  SCHEME_ASSERT ((argc == 1), #tag "vector-sum: wrong number of args"); \
+  SCHEME_ASSERT (SCHEME_##TAG##VECTORP (argv[0]), \
+		 #tag "vector-sum: arg must be a " #tag "vector"); \
+  return (TAG##_ACC_TO (tag##_sum (SCHEME_##TAG##VEC_ELS (argv[0]), \
+				   SCHEME_NUMVEC_SIZE (argv[0])))); \
+} \
+\
+static Scheme_Object * \
+tag##vector_dot (int argc, Scheme_Object *argv[]) \
+{ \
+  SCHEME_ASSERT ((argc == 2), #tag "vector-dot: wrong number of args"); \
+  SCHEME_ASSERT (SCHEME_##TAG##VECTORP (argv[0]) && SCHEME_##TAG##VECTORP (argv[1]), \
+		 #tag "vector-dot: both args must be " #tag "vectors"); \
+  SCHEME_ASSERT (SCHEME_NUMVEC_SIZE (argv[0]) == SCHEME_NUMVEC_SIZE (argv[1]), \
+		 #tag "vector-dot: vectors must be the same length"); \
+  return (TAG##_ACC_TO (tag##_dot (SCHEME_##TAG##VEC_ELS (argv[0]), \
+				   SCHEME_##TAG##VEC_ELS (argv[1]), \
+				   SCHEME_NUMVEC_SIZE (argv[0])))); \
+} \
+\
+static Scheme_Object * \
+tag##vector_scale (int argc, Scheme_Object *argv[]) \
+{ \
+  SCHEME_ASSERT ((argc == 2), #tag "vector-scale!: wrong number of args"); \
+  SCHEME_ASSERT (SCHEME_##TAG##VECTORP (argv[0]), \
+		 #tag "vector-scale!: first arg must be a " #tag "vector"); \
+  SCHEME_ASSERT (TAG##_SCALAR (argv[1]), #tag "vector-scale!: bad factor"); \
+  tag##_scale (SCHEME_##TAG##VEC_ELS (argv[0]), SCHEME_NUMVEC_SIZE (argv[0]), \
+	       TAG##_SCALAR_VAL (argv[1])); \
+  return (argv[0]); \
+} \
+\
+static Scheme_Object * \
+tag##vector_add (int argc, Scheme_Object *argv[]) \
+{ \
+  SCHEME_ASSERT ((argc == 2), #tag "vector-add!: wrong number of args"); \
+  SCHEME_ASSERT (SCHEME_##TAG##VECTORP (argv[0]) && SCHEME_##TAG##VECTORP (argv[1]), \
+		 #tag "vector-add!: both args must be " #tag "vectors"); \
+  SCHEME_ASSERT (SCHEME_NUMVEC_SIZE (argv[0]) == SCHEME_NUMVEC_SIZE (argv[1]), \
+		 #tag "vector-add!: vectors must be the same length"); \
+  tag##_add (SCHEME_##TAG##VEC_ELS (argv[0]), SCHEME_##TAG##VEC_ELS (argv[1]), \
+	     SCHEME_NUMVEC_SIZE (argv[0])); \
+  return (argv[0]); \
+} \
+\
+static Scheme_Object * \
+tag##vector_min (int argc, Scheme_Object *argv[]) \
+{ \
+  SCHEME_ASSERT ((argc == 1), #tag "vector-min: wrong number of args"); \
+  SCHEME_ASSERT (SCHEME_##TAG##VECTORP (argv[0]), \
+		 #tag "vector-min: arg must be a " #tag "vector"); \
+  SCHEME_ASSERT (SCHEME_NUMVEC_SIZE (argv[0]) > 0, #tag "vector-min: vector is empty"); \
+  return (TAG##_TO (tag##_min (SCHEME_##TAG##VEC_ELS (argv[0]), \
+			       SCHEME_NUMVEC_SIZE (argv[0])))); \
+} \
+\
+static Scheme_Object * \
+tag##vector_max (int argc, Scheme_Object *argv[]) \
+{ \
+  SCHEME_ASSERT ((argc == 1), #tag "vector-max: wrong number of args"); \
+  SCHEME_ASSERT (SCHEME_##TAG##VECTORP (argv[0]), \
+		 #tag "vector-max: arg must be a " #tag "vector"); \
+  SCHEME_ASSERT (SCHEME_NUMVEC_SIZE (argv[0]) > 0, #tag "vector-max: vector is empty"); \
+  return (TAG##_TO (tag##_max (SCHEME_##TAG##VEC_ELS (argv[0]), \
+			       SCHEME_NUMVEC_SIZE (argv[0])))); \
+}
+
+GEN_NUMVEC_PROT(u8);
+GEN_NUMVEC_PROT(s32);
+GEN_NUMVEC_PROT(f64);
+
+void
+scheme_init_numvec (Scheme_Env *env)
+{
+  scheme_u8vector_type = scheme_make_type ("<u8vector>");
+  scheme_s32vector_type = scheme_make_type ("<s32vector>");
+  scheme_f64vector_type = scheme_make_type ("<f64vector>");
+  scheme_add_global ("<u8vector>", scheme_u8vector_type, env);
+  scheme_add_global ("<s32vector>", scheme_s32vector_type, env);
+  scheme_add_global ("<f64vector>", scheme_f64vector_type, env);
+  GEN_NUMVEC_INIT(u8, env);
+  GEN_NUMVEC_INIT(s32, env);
+  GEN_NUMVEC_INIT(f64, env);
+
+  big_symbol = scheme_intern_symbol ("big");
+  little_symbol = scheme_intern_symbol ("little");
+  scheme_add_global ("bytevector?", scheme_make_prim (u8vector_p), env);
+  scheme_add_global ("make-bytevector", scheme_make_prim (make_u8vector), env);
+  scheme_add_global ("bytevector", scheme_make_prim (u8vector), env);
+  scheme_add_global ("bytevector-length", scheme_make_prim (u8vector_length), env);
+  scheme_add_global ("bytevector-u8-ref", scheme_make_prim (u8vector_ref), env);
+  scheme_add_global ("bytevector-u8-set!", scheme_make_prim (u8vector_set), env);
+  scheme_add_global ("bytevector-copy", scheme_make_prim (u8vector_copy), env);
+  scheme_add_global ("bytevector-copy!", scheme_make_prim (bytevector_copy_x), env);
+  scheme_add_global ("utf8->string", scheme_make_prim (utf8_to_string), env);
+  scheme_add_global ("string->utf8", scheme_make_prim (string_to_utf8), env);
+  scheme_add_global ("bytevector-u16-ref", scheme_make_prim (bytevector_u16_ref), env);
+  scheme_add_global ("bytevector-u16-set!", scheme_make_prim (bytevector_u16_set), env);
+  scheme_add_global ("bytevector-u32-ref", scheme_make_prim (bytevector_u32_ref), env);
+  scheme_add_global ("bytevector-u32-set!", scheme_make_prim (bytevector_u32_set), env);
+  scheme_add_global ("bytevector-u64-ref", scheme_make_prim (bytevector_u64_ref), env);
+  scheme_add_global ("bytevector-u64-set!", scheme_make_prim (bytevector_u64_set), env);
+  scheme_add_global ("bytevector-f64-ref", scheme_make_prim (bytevector_f64_ref), env);
+  scheme_add_global ("bytevector-f64-set!", scheme_make_prim (bytevector_f64_set), env);
+}
+
+/* The elements follow the object, as with vectors, but the block
+   holds no pointers the collector needs to see: the type objects are
+   all reachable from globals. */
+
+Scheme_Object *
+scheme_alloc_numvec (Scheme_Object *type, int size, int el_size)
+{
+  Scheme_Object *vec;
+
+  vec = (Scheme_Object *) scheme_malloc_atomic (sizeof (Scheme_Object)
+						+ (size_t) el_size * size);
+  _SCHEME_TYPE (vec) = type;
+  SCHEME_NUMVEC_SIZE (vec) = size;
+  return (vec);
+}
+
+/* Check the optional start and end args of an operation on a numeric
+   vector vec, from argv[first] on, and find their values. */
+
+void
+scheme_numvec_range (char *name, Scheme_Object *vec, int argc,
+		     Scheme_Object *argv[], int first, int *start, int *end)
+{
+  *start = 0;
+  *end = SCHEME_NUMVEC_SIZE (vec);
+  if (argc > first)
+    {
+      if (! SCHEME_INTP (argv[first]))
+	{
+	  scheme_signal_error ("%s: start must be an integer", name);
+	}
+      *start = SCHEME_INT_VAL (argv[first]);
+    }
+  if (argc > first + 1)
+    {
+      if (! SCHEME_INTP (argv[first + 1]))
+	{
+	  scheme_signal_error ("%s: end must be an integer", name);
+	}
+      *end = SCHEME_INT_VAL (argv[first + 1]);
+    }
+  if (*start < 0 || *start > *end || *end > SCHEME_NUMVEC_SIZE (vec))
+    {
+      scheme_signal_error ("%s: range out of bounds", name);
+    }
+}
+
+/* locals */
+
+GEN_NUMVEC(u8, U8, unsigned char)
+GEN_NUMVEC(s32, S32, int32_t)
+GEN_NUMVEC(f64, F64, double)
+
+static Scheme_Object *
+make_int64 (int64_t n)
+{
+  if (n >= INT_MIN && n <= INT_MAX)
+    {
+      return (scheme_make_integer ((int) n));
+    }
+  return (scheme_make_double ((double) n));
+}
+
+static Scheme_Object *
+make_uint64 (uint64_t n)
+{
+  if (n <= INT_MAX)
+    {
+      return (scheme_make_integer ((int) n));
+    }
+  return (scheme_make_double ((double) n));
+}
+
+/* bytevectors */
+
+static Scheme_Object *
+bytevector_copy_x (int argc, Scheme_Object *argv[])
+{
+  int at, start, end;
+
+  SCHEME_ASSERT ((argc >= 3 && argc <= 5), "bytevector-copy!: wrong number of args");
+  SCHEME_ASSERT (SCHEME_U8VECTORP (argv[0]) && SCHEME_U8VECTORP (argv[2]),
+		 "bytevector-copy!: first and third args must be bytevectors");
+  SCHEME_ASSERT (SCHEME_INTP (argv[1]), "bytevector-copy!: second arg must be an integer");
+  scheme_numvec_range ("bytevector-copy!", argv[2], argc, argv, 3, &start, &end);
+  at = SCHEME_INT_VAL (argv[1]);
+  SCHEME_ASSERT ((at >= 0 && at <= SCHEME_NUMVEC_SIZE (argv[0]) - (end - start)),
+		 "bytevector-copy!: destination out of range");
+  memmove (SCHEME_U8VEC_ELS (argv[0]) + at, SCHEME_U8VEC_ELS (argv[2]) + start,
+	   end - start);
+  return (argv[0]);
+}
+
+static Scheme_Object *
+utf8_to_string (int argc, Scheme_Object *argv[])
+{
+  int start, end;
+
+  SCHEME_ASSERT ((argc >= 1 && argc <= 3), "utf8->string: wrong number of args");
+  SCHEME_ASSERT (SCHEME_U8VECTORP (argv[0]), "utf8->string: first arg must be a bytevector");
+  scheme_numvec_range ("utf8->string", argv[0], argc, argv, 1, &start, &end);
+  return (scheme_make_sized_string ((char *) SCHEME_U8VEC_ELS (argv[0]) + start,
+				    end - start));
+}
+
+static Scheme_Object *
+string_to_utf8 (int argc, Scheme_Object *argv[])
+{
+  Scheme_Object *vec;
+
+  SCHEME_ASSERT ((argc == 1), "string->utf8: wrong number of args");
+  SCHEME_ASSERT (SCHEME_STRINGP (argv[0]), "string->utf8: arg must be a string");
+  vec = scheme_alloc_numvec (scheme_u8vector_type, SCHEME_STR_LEN (argv[0]), 1);
+  memcpy (SCHEME_U8VEC_ELS (vec), SCHEME_STR_VAL (argv[0]), SCHEME_STR_LEN (argv[0]));
+  return (vec);
+}
+
+/* The typed accessors take a bytevector, a byte offset, a value to
+   store for the setters, and 'big or 'little last, as in R6RS.  With
+   fixnums only as wide as an int, a u32 or u64 above INT_MAX comes
+   back as a double: exact up to 2^53, and rounded to the nearest
+   double beyond that, so the low bits of a large u64 are lost. */
+
+static unsigned char *
+bytevector_slot (char *name, int argc, Scheme_Object *argv[], int nargs,
+		 int size, int *big)
+{
+  int k;
+
+  if (argc != nargs)
+    {
+      scheme_signal_error ("%s: wrong number of args", name);
+    }
+  if (! SCHEME_U8VECTORP (argv[0]))
+    {
+      scheme_signal_error ("%s: first arg must be a bytevector", name);
+    }
+  if (! SCHEME_INTP (argv[1]))
+    {
+      scheme_signal_error ("%s: second arg must be an integer", name);
+    }
+  k = SCHEME_INT_VAL (argv[1]);
+  if (k < 0 || k > SCHEME_NUMVEC_SIZE (argv[0]) - size)
+    {
+      scheme_signal_error ("%s: index out of range: %d", name, k);
+    }
+  if (argv[nargs - 1] == big_symbol)
+    {
+      *big = 1;
+    }
+  else if (argv[nargs - 1] == little_symbol)
+    {
+      *big = 0;
+    }
+  else
+    {
+      scheme_signal_error ("%s: byte order must be big or little", name);
+    }
+  return (SCHEME_U8VEC_ELS (argv[0]) + k);
+}
+
+static uint64_t
+get_bytes (unsigned char *p, int size, int big)
+{
+  uint64_t val = 0;
+  int i;
+
+  for ( i=0 ; i<size ; ++i )
+    {
+      val = (val << 8) | p[big ? i : size - 1 - i];
+    }
+  return (val);
+}
+
+static void
+put_bytes (unsigned char *p, int size, int big, uint64_t val)
+{
+  int i;
+
+  for ( i=0 ; i<size ; ++i )
+    {
+      p[big ? size - 1 - i : i] = (unsigned char) val;
+      val >>= 8;
+    }
+}
+
+static uint64_t
+unsigned_arg (char *name, Scheme_Object *obj, int size)
+{
+  double d = 0;
+
+  if (SCHEME_INTP (obj) && SCHEME_INT_VAL (obj) >= 0)
+    {
+      d = SCHEME_INT_VAL (obj);
+    }
+  else if (SCHEME_DBLP (obj) && SCHEME_DBL_VAL (obj) >= 0)
+    {
+      d = SCHEME_DBL_VAL (obj);
+    }
+  else
+    {
+      scheme_signal_error ("%s: value must be a non-negative number", name);
+    }
+  if (size < 8 ? d >= (double) ((uint64_t) 1 << (size * 8))
+      : d >= 18446744073709551616.0)
+    {
+      scheme_signal_error ("%s: value out of range", name);
+    }
+  return ((uint64_t) d);
+}
+
+#define GEN_BYTEVECTOR_UINT(ref, set, scheme_ref, scheme_set, size) \
+static Scheme_Object * \
+ref (int argc, Scheme_Object *argv[]) \
+{ \
+  unsigned char *p; \
+  int big; \
+\
+  p = bytevector_slot (scheme_ref, argc, argv, 3, size, &big); \
+  return (make_uint64 (get_bytes (p, size, big))); \
+} \
+\
+static Scheme_Object * \
+set (int argc, Scheme_Object *argv[]) \
+{ \
+  unsigned char *p; \
+  int big; \
+\
+  p = bytevector_slot (scheme_set, argc, argv, 4, size, &big); \
+  put_bytes (p, size, big, unsigned_arg (scheme_set, argv[2], size)); \
+  return (argv[0]); \
+}
+
+GEN_BYTEVECTOR_UINT(bytevector_u16_ref, bytevector_u16_set,
+		    "bytevector-u16-ref", "bytevector-u16-set!", 2)
+GEN_BYTEVECTOR_UINT(bytevector_u32_ref, bytevector_u32_set,
+		    "bytevector-u32-ref", "bytevector-u32-set!", 4)
+GEN_BYTEVECTOR_UINT(bytevector_u64_ref, bytevector_u64_set,
+		    "bytevector-u64-ref", "bytevector-u64-set!", 8)
+
+static Scheme_Object *
+bytevector_f64_ref (int argc, Scheme_Object *argv[])
+{
+  unsigned char *p;
+  uint64_t bits;
+  double d;
+  int big;
+
+  p = bytevector_slot ("bytevector-f64-ref", argc, argv, 3, 8, &big);
+  bits = get_bytes (p, 8, big);
+  memcpy (&d, &bits, 8);
+  return (scheme_make_double (d));
+}
+
+static Scheme_Object *
+bytevector_f64_set (int argc, Scheme_Object *argv[])
+{
+  unsigned char *p;
+  uint64_t bits;
+  double d;
+  int big;
+
+  p = bytevector_slot ("bytevector-f64-set!", argc, argv, 4, 8, &big);
+  SCHEME_ASSERT (F64_CHECK (argv[2]), "bytevector-f64-set!: value must be a number");
+  d = F64_FROM (argv[2]);
+  memcpy (&bits, &d, 8);
+  put_bytes (p, 8, big, bits);
+  return (argv[0]);
+}
+
+/* Bulk kernels.  Each does what it can a vector register at a time
+   and finishes the rest, or all of it without SSE2, one element at a
+   time.  Integer arithmetic wraps around as the element type does.
+   Only u8 and the s32 add have vector loops for integers; the other
+   s32 kernels need SSE4.1 and stay scalar.  The f64 min and max of a
+   vector holding a NaN is its first NaN, whichever loop finds it. */
+
+static int64_t
+u8_sum (unsigned char *els, int n)
+{
+  int64_t sum = 0;
+  int i = 0;
+
+#ifdef __SSE2__
+  __m128i zero = _mm_setzero_si128 (), acc = zero;
+
+  for ( ; i+16<=n ; i+=16 )
+    {
+      acc = _mm_add_epi64 (acc, _mm_sad_epu8 (_mm_loadu_si128 ((__m128i *) (els + i)), zero));
+    }
+  sum = _mm_cvtsi128_si64 (acc) + _mm_cvtsi128_si64 (_mm_unpackhi_epi64 (acc, acc));
+#endif
+  for ( ; i<n ; ++i )
+    {
+      sum += els[i];
+    }
+  return (sum);
+}
+
+static int64_t
+u8_dot (unsigned char *els1, unsigned char *els2, int n)
+{
+  int64_t sum = 0;
+  int i;
+
+  for ( i=0 ; i<n ; ++i )
+    {
+      sum += els1[i] * els2[i];
+    }
+  return (sum);
+}
+
+static void
+u8_scale (unsigned char *els, int n, int k)
+{
+  int i;
+
+  for ( i=0 ; i<n ; ++i )
+    {
+      els[i] = (unsigned char) (els[i] * k);
+    }
+}
+
+static void
+u8_add (unsigned char *dst, unsigned char *src, int n)
+{
+  int i = 0;
+
+#ifdef __SSE2__
+  for ( ; i+16<=n ; i+=16 )
+    {
+      _mm_storeu_si128 ((__m128i *) (dst + i),
+			_mm_add_epi8 (_mm_loadu_si128 ((__m128i *) (dst + i)),
+				      _mm_loadu_si128 ((__m128i *) (src + i))));
+    }
+#endif
+  for ( ; i<n ; ++i )
+    {
+      dst[i] = (unsigned char) (dst[i] + src[i]);
+    }
+}
+
+static int
+u8_min (unsigned char *els, int n)
+{
+  unsigned char min = els[0];
+  int i = 0;
+
+#ifdef __SSE2__
+  if (n >= 16)
+    {
+      unsigned char lanes[16];
+      __m128i acc = _mm_loadu_si128 ((__m128i *) els);
+
+      for ( i=16 ; i+16<=n ; i+=16 )
+	{
+	  acc = _mm_min_epu8 (acc, _mm_loadu_si128 ((__m128i *) (els + i)));
+	}
+      _mm_storeu_si128 ((__m128i *) lanes, acc);
+      min = u8_min (lanes, 15);
+      min = (lanes[15] < min) ? lanes[15] : min;
+    }
+#endif
+  for ( ; i<n ; ++i )
+    {
+      if (els[i] < min)
+	{
+	  min = els[i];
+	}
+    }
+  return (min);
+}
+
+static int
+u8_max (unsigned char *els, int n)
+{
+  unsigned char max = els[0];
+  int i = 0;
+
+#ifdef __SSE2__
+  if (n >= 16)
+    {
+      unsigned char lanes[16];
+      __m128i acc = _mm_loadu_si128 ((__m128i *) els);
+
+      for ( i=16 ; i+16<=n ; i+=16 )
+	{
+	  acc = _mm_max_epu8 (acc, _mm_loadu_si128 ((__m128i *) (els + i)));
+	}
+      _mm_storeu_si128 ((__m128i *) lanes, acc);
+      max = u8_max (lanes, 15);
+      max = (lanes[15] > max) ? lanes[15] : max;
+    }
+#endif
+  for ( ; i<n ; ++i )
+    {
+      if (els[i] > max)
+	{
+	  max = els[i];
+	}
+    }
+  return (max);
+}
+
+static int64_t
+s32_sum (int32_t *els, int n)
+{
+  int64_t sum = 0;
+  int i;
+
+  for ( i=0 ; i<n ; ++i )
+    {
+      sum += els[i];
+    }
+  return (sum);
+}
+
+static int64_t
+s32_dot (int32_t *els1, int32_t *els2, int n)
+{
+  int64_t sum = 0;
+  int i;
+
+  for ( i=0 ; i<n ; ++i )
+    {
+      sum += (int64_t) els1[i] * els2[i];
+    }
+  return (sum);
+}
+
+static void
+s32_scale (int32_t *els, int n, int k)
+{
+  int i;
+
+  for ( i=0 ; i<n ; ++i )
+    {
+      els[i] = (int32_t) ((uint32_t) els[i] * (uint32_t) k);
+    }
+}
+
+static void
+s32_add (int32_t *dst, int32_t *src, int n)
+{
+  int i = 0;
+
+#ifdef __SSE2__
+  for ( ; i+4<=n ; i+=4 )
+    {
+      _mm_storeu_si128 ((__m128i *) (dst + i),
+			_mm_add_epi32 (_mm_loadu_si128 ((__m128i *) (dst + i)),
+				       _mm_loadu_si128 ((__m128i *) (src + i))));
+    }
+#endif
+  for ( ; i<n ; ++i )
+    {
+      dst[i] = (int32_t) ((uint32_t) dst[i] + (uint32_t) src[i]);
+    }
+}
+
+static int32_t
+s32_min (int32_t *els, int n)
+{
+  int32_t min = els[0];
+  int i;
+
+  for ( i=1 ; i<n ; ++i )
+    {
+      if (els[i] < min)
+	{
+	  min = els[i];
+	}
+    }
+  return (min);
+}
+
+static int32_t
+s32_max (int32_t *els, int n)
+{
+  int32_t max = els[0];
+  int i;
+
+  for ( i=1 ; i<n ; ++i )
+    {
+      if (els[i] > max)
+	{
+	  max = els[i];
+	}
+    }
+  return (max);
+}
+
+/* f64 kernels go through these, two doubles a register.  Only
+   SSE2 is used: it is the x86_64 baseline, and nothing here is built
+   for, or checks at run time for, anything wider. */
+
+#ifdef __SSE2__
+#define F64_LANES	2
+#define F64_VEC		__m128d
+#define F64_ZERO()	_mm_setzero_pd ()
+#define F64_SET1(x)	_mm_set1_pd (x)
+#define F64_LOAD(p)	_mm_loadu_pd (p)
+#define F64_STORE(p, v)	_mm_storeu_pd ((p), (v))
+#define F64_ADD(a, b)	_mm_add_pd ((a), (b))
+#define F64_MUL(a, b)	_mm_mul_pd ((a), (b))
+#define F64_MIN(a, b)	_mm_min_pd ((a), (b))
+#define F64_MAX(a, b)	_mm_max_pd ((a), (b))
+#define F64_UNORD(a, b)	_mm_cmpunord_pd ((a), (b))
+#define F64_OR(a, b)	_mm_or_pd ((a), (b))
+#define F64_ANY(mask)	_mm_movemask_pd (mask)
+#endif
+
+static double
+f64_sum (double *els, int n)
+{
+  double sum = 0.0;
+  int i = 0;
+
+#ifdef F64_LANES
+  double lanes[F64_LANES];
+  F64_VEC acc0 = F64_ZERO (), acc1 = F64_ZERO ();
+  int j;
+
+  for ( ; i+2*F64_LANES<=n ; i+=2*F64_LANES )
+    {
+      acc0 = F64_ADD (acc0, F64_LOAD (els + i));
+      acc1 = F64_ADD (acc1, F64_LOAD (els + i + F64_LANES));
+    }
+  F64_STORE (lanes, F64_ADD (acc0, acc1));
+  for ( j=0 ; j<F64_LANES ; ++j )
+    {
+      sum += lanes[j];
+    }
+#endif
+  for ( ; i<n ; ++i )
+    {
+      sum += els[i];
+    }
+  return (sum);
+}
+
+static double
+f64_dot (double *els1, double *els2, int n)
+{
+  double sum = 0.0;
+  int i = 0;
+
+#ifdef F64_LANES
+  double lanes[F64_LANES];
+  F64_VEC acc0 = F64_ZERO (), acc1 = F64_ZERO ();
+  int j;
+
+  for ( ; i+2*F64_LANES<=n ; i+=2*F64_LANES )
+    {
+      acc0 = F64_ADD (acc0, F64_MUL (F64_LOAD (els1 + i), F64_LOAD (els2 + i)));
+      acc1 = F64_ADD (acc1, F64_MUL (F64_LOAD (els1 + i + F64_LANES),
+				     F64_LOAD (els2 + i + F64_LANES)));
+    }
+  F64_STORE (lanes, F64_ADD (acc0, acc1));
+  for ( j=0 ; j<F64_LANES ; ++j )
+    {
+      sum += lanes[j];
+    }
+#endif
+  for ( ; i<n ; ++i )
+    {
+      sum += els1[i] * els2[i];
+    }
+  return (sum);
+}
+
+static void
+f64_scale (double *els, int n, double k)
+{
+  int i = 0;
+
+#ifdef F64_LANES
+  F64_VEC factor = F64_SET1 (k);
+
+  for ( ; i+F64_LANES<=n ; i+=F64_LANES )
+    {
+      F64_STORE (els + i, F64_MUL (F64_LOAD (els + i), factor));
+    }
+#endif
+  for ( ; i<n ; ++i )
+    {
+      els[i] *= k;
+    }
+}
+
+static void
+f64_add (double *dst, double *src, int n)
+{
+  int i = 0;
+
+#ifdef F64_LANES
+  for ( ; i+F64_LANES<=n ; i+=F64_LANES )
+    {
+      F64_STORE (dst + i, F64_ADD (F64_LOAD (dst + i), F64_LOAD (src + i)));
+    }
+#endif
+  for ( ; i<n ; ++i )
+    {
+      dst[i] += src[i];
+    }
+}
+
+static double
+f64_min (double *els, int n)
+{
+  double min = els[0];
+  int i = 0;
+
+#ifdef F64_LANES
+  if (n >= F64_LANES)
+    {
+      double lanes[F64_LANES];
+      F64_VEC acc = F64_LOAD (els), nan = F64_UNORD (acc, acc), v;
+      int j;
+
+      for ( i=F64_LANES ; i+F64_LANES<=n ; i+=F64_LANES )
+	{
+	  v = F64_LOAD (els + i);
+	  nan = F64_OR (nan, F64_UNORD (v, v));
+	  acc = F64_MIN (acc, v);
+	}
+      if (F64_ANY (nan))
+	{
+	  /* let the loop below find the first NaN */
+	  i = 0;
+	}
+      else
+	{
+	  F64_STORE (lanes, acc);
+	  for ( j=0 ; j<F64_LANES ; ++j )
+	    {
+	      if (lanes[j] < min)
+		{
+		  min = lanes[j];
+		}
+	    }
+	}
+    }
+#endif
+  for ( ; i<n ; ++i )
+    {
+      if (els[i] != els[i])
+	{
+	  return (els[i]);
+	}
+      if (els[i] < min)
+	{
+	  min = els[i];
+	}
+    }
+  return (min);
+}
+
+static double
+f64_max (double *els, int n)
+{
+  double max = els[0];
+  int i = 0;
+
+#ifdef F64_LANES
+  if (n >= F64_LANES)
+    {
+      double lanes[F64_LANES];
+      F64_VEC acc = F64_LOAD (els), nan = F64_UNORD (acc, acc), v;
+      int j;
+
+      for ( i=F64_LANES ; i+F64_LANES<=n ; i+=F64_LANES )
+	{
+	  v = F64_LOAD (els + i);
+	  nan = F64_OR (nan, F64_UNORD (v, v));
+	  acc = F64_MAX (acc, v);
+	}
+      if (F64_ANY (nan))
+	{
+	  /* let the loop below find the first NaN */
+	  i = 0;
+	}
+      else
+	{
+	  F64_STORE (lanes, acc);
+	  for ( j=0 ; j<F64_LANES ; ++j )
+	    {
+	      if (lanes[j] > max)
+		{
+		  max = lanes[j];
+		}
+	    }
+	}
+    }
+#endif
+  for ( ; i<n ; ++i )
+    {
+      if (els[i] != els[i])
+	{
+	  return (els[i]);
+	}
+      if (els[i] > max)
+	{
+	  max = els[i];
+	}
+    }
+  return (max);
+}
@@ -25,6 +25,7 @@
 #include "scheme.h"
 #include <stdio.h>
 #include <string.h>
+#include <errno.h>
 #include <sys/select.h>
 
 /* #define HAS_STANDARD_IOB 1 */
@@ -39,7 +40,6 @@ struct Scheme_Indexed_String
 typedef struct Scheme_Indexed_String Scheme_Indexed_String;
 
 /* globals */
-Scheme_Object *scheme_eof;
 Scheme_Object *scheme_eof_type;
 Scheme_Object *scheme_input_port_type, *scheme_output_port_type;
 Scheme_Object *scheme_stdin_port;
@@ -55,7 +55,6 @@ static Scheme_Object *scheme_file_output_port_type;
 
 /* generic ports */
 
-static Scheme_Object *scheme_make_eof (void);
 static Scheme_Object *call_with_input_file (int argc, Scheme_Object *argv[]);
 static Scheme_Object *call_with_output_file (int argc, Scheme_Object *argv[]);
 static Scheme_Object *input_port_p (int argc, Scheme_Object *argv[]);
@@ -77,24 +76,28 @@ static Scheme_Object *write (int argc, Scheme_Object *argv[]);
 static Scheme_Object *display (int argc, Scheme_Object *argv[]);
 static Scheme_Object *newline (int argc, Scheme_Object *argv[]);
 static Scheme_Object *write_char (int argc, Scheme_Object *argv[]);
+static Scheme_Object *read_bytevector (int argc, Scheme_Object *argv[]);
+static Scheme_Object *write_bytevector (int argc, Scheme_Object *argv[]);
 static Scheme_Object *load (int argc, Scheme_Object *argv[]);
 /* non-standard */
 static Scheme_Object *flush_output (int argc, Scheme_Object *argv[]);
 static Scheme_Object *with_input_from_string (int argc, Scheme_Object *argv[]);
 static Scheme_Object *open_input_string (int argc, Scheme_Object *argv[]);
 
+static FILE *open_file (char *filename, char *mode);
+
 void 
 scheme_init_port (Scheme_Env *env)
 {
   scheme_eof_type = scheme_make_type ("<eof>");
   scheme_add_global ("<eof>", scheme_eof_type, env);
-  scheme_eof = scheme_make_eof ();
-  scheme_input_port_type = scheme_make_type ("<input-port>");
+  scheme_set_tag_type (scheme_eof, 5, scheme_eof_type);
+  scheme_input_port_type = scheme_make_layout_type ("<input-port>", SCHEME_LAYOUT_PTR1);
   scheme_file_input_port_type = scheme_make_type ("<file-input-port>");
   scheme_string_input_port_type = scheme_make_type ("<string-input-port>");
   scheme_file_output_port_type = scheme_make_type ("<file-output-port>");
   scheme_add_global ("<input-port>", scheme_input_port_type, env);
-  scheme_output_port_type = scheme_make_type ("<output-port>");
+  scheme_output_port_type = scheme_make_layout_type ("<output-port>", SCHEME_LAYOUT_PTR1);
   cur_in_port = scheme_stdin_port = scheme_make_file_input_port (stdin);
   cur_out_port = scheme_stdout_port = scheme_make_file_output_port (stdout);
   scheme_stderr_port = scheme_make_file_output_port (stderr);
@@ -122,22 +125,14 @@ scheme_init_port (Scheme_Env *env)
   scheme_add_global ("display", scheme_make_prim (display), env);
   scheme_add_global ("newline", scheme_make_prim (newline), env);
   scheme_add_global ("write-char", scheme_make_prim (write_char), env);
+  scheme_add_global ("read-bytevector!", scheme_make_prim (read_bytevector), env);
+  scheme_add_global ("write-bytevector", scheme_make_prim (write_bytevector), env);
   scheme_add_global ("load", scheme_make_prim (load), env);
   scheme_add_global ("flush-output", scheme_make_prim (flush_output), env);
   scheme_add_global ("write-to-string", scheme_make_prim (write), env);
   scheme_add_global ("display-to-string", scheme_make_prim (display), env);
 }
 
-static Scheme_Object *
-scheme_make_eof (void)
-{
-  Scheme_Object *eof;
-
-  eof = scheme_alloc_object ();
-  SCHEME_TYPE (eof) = scheme_eof_type;
-  return (eof);
-}
-
 Scheme_Input_Port *
 scheme_make_input_port (Scheme_Object *subtype,
 			void *data,
@@ -161,7 +156,7 @@ scheme_make_input_port (Scheme_Object *subtype,
 Scheme_Output_Port *
 scheme_make_output_port (Scheme_Object *subtype,
 			 void *data,
-			 void (*write_string_fun) (char *str, Scheme_Output_Port*),
+			 void (*write_string_fun) (char *str, int len, Scheme_Output_Port*),
 			 void (*close_fun) (Scheme_Output_Port*))
 {
   Scheme_Output_Port *op;
@@ -227,6 +222,23 @@ scheme_close_output_port (Scheme_Object *port)
     }
 }
 
+/* Like fopen(), but when out of descriptors, collects so that the
+   finalizers of unreachable ports close theirs, and tries again. */
+
+static FILE *
+open_file (char *filename, char *mode)
+{
+  FILE *fp;
+
+  fp = fopen (filename, mode);
+  if (! fp && (errno == EMFILE || errno == ENFILE))
+    {
+      scheme_gc_collect ();
+      fp = fopen (filename, mode);
+    }
+  return (fp);
+}
+
 /* file input ports */
 
 static int 
@@ -277,14 +289,23 @@ file_close_input (Scheme_Input_Port *port)
   fclose (fp);
 }
 
+/* File ports close themselves when they are collected, so that a
+   port dropped by an error, or never closed, does not keep its file
+   open. */
+
+static void
+finalize_input_port (void *port, void *data)
+{
+  scheme_close_input_port ((Scheme_Object *) port);
+}
+
 Scheme_Object *
 scheme_make_file_input_port (FILE *fp)
 {
   Scheme_Object *port;
   Scheme_Input_Port *ip;
 
-  port = scheme_alloc_object ();
-  SCHEME_TYPE (port) = scheme_input_port_type;
+  port = scheme_alloc_typed_object (scheme_input_port_type);
   SCHEME_PTR_VAL (port) = 
     scheme_make_input_port (scheme_file_input_port_type,
 			    fp,
@@ -292,6 +313,7 @@ scheme_make_file_input_port (FILE *fp)
 			    file_ungetc,
 			    file_char_ready,
 			    file_close_input);
+  scheme_register_finalizer (port, finalize_input_port, NULL);
   return (port);
 }
 
@@ -309,7 +331,7 @@ string_getc (Scheme_Input_Port *port)
     }
   else
     {
-      return (is->string[is->index++]);
+      return ((unsigned char) is->string[is->index++]);
     }
 }
 
@@ -341,27 +363,27 @@ string_close (Scheme_Input_Port *port)
 }
 
 static Scheme_Indexed_String *
-scheme_make_indexed_string (char *str)
+scheme_make_indexed_string (char *str, int len)
 {
   Scheme_Indexed_String *is;
 
   is = (Scheme_Indexed_String *) scheme_malloc (sizeof (Scheme_Indexed_String));
-  is->string = scheme_strdup (str);
-  is->size = strlen (str);
+  is->string = (char *) scheme_malloc_atomic (len);
+  memcpy (is->string, str, len);
+  is->size = len;
   is->index = 0;
   return (is);
 }
 
 Scheme_Object *
-scheme_make_string_input_port (char *str)
+scheme_make_string_input_port (char *str, int len)
 {
   Scheme_Object *port;
 
-  port = scheme_alloc_object ();
-  SCHEME_TYPE (port) = scheme_input_port_type;
+  port = scheme_alloc_typed_object (scheme_input_port_type);
   SCHEME_PTR_VAL (port) =
     scheme_make_input_port (scheme_string_input_port_type,
-			    scheme_make_indexed_string (str),
+			    scheme_make_indexed_string (str, len),
 			    string_getc,
 			    string_ungetc,
 			    string_char_ready,
@@ -372,10 +394,10 @@ scheme_make_string_input_port (char *str)
 /* file output ports */
 
 static void
-file_write_string (char *str, Scheme_Output_Port *port)
+file_write_string (char *str, int len, Scheme_Output_Port *port)
 {
   FILE *fp = (FILE *) port->port_data;
-  fprintf (fp, "%s", str);
+  fwrite (str, 1, len, fp);
 }
 
 static void
@@ -385,18 +407,24 @@ file_close_output (Scheme_Output_Port *port)
   fclose (fp);
 }
 
+static void
+finalize_output_port (void *port, void *data)
+{
+  scheme_close_output_port ((Scheme_Object *) port);
+}
+
 Scheme_Object *
 scheme_make_file_output_port (FILE *fp)
 {
   Scheme_Object *port;
 
-  port = scheme_alloc_object ();
-  SCHEME_TYPE(port) = scheme_output_port_type;
+  port = scheme_alloc_typed_object (scheme_output_port_type);
   SCHEME_PTR_VAL(port) = 
     scheme_make_output_port (scheme_file_output_port_type,
 			     fp,
 			     file_write_string,
 			     file_close_output);
+  scheme_register_finalizer (port, finalize_output_port, NULL);
   return (port);
 }
 
@@ -413,14 +441,14 @@ call_with_input_file (int argc, Scheme_Object *argv[])
   SCHEME_ASSERT (SCHEME_PROCP (argv[1]),
 		 "call-with-input-file: second arg must be a procedure");
   filename = SCHEME_STR_VAL (argv[0]);
-  fp = fopen (filename, "r");
+  fp = open_file (filename, "r");
   if (! fp)
     {
       scheme_signal_error ("cannot open file for input: %s", filename);
     }
   port = scheme_make_file_input_port (fp);
   ret = scheme_apply_to_list (argv[1], scheme_make_pair (port, scheme_null));
-  fclose (fp);
+  scheme_close_input_port (port);
   return (ret);
 }
 
@@ -437,14 +465,14 @@ call_with_output_file (int argc, Scheme_Object *argv[])
   SCHEME_ASSERT (SCHEME_PROCP (argv[1]),
 		 "call-with-output-file: second arg must be a procedure");
   filename = SCHEME_STR_VAL (argv[0]);
-  fp = fopen (filename, "w");
+  fp = open_file (filename, "w");
   if (! fp)
     {
       scheme_signal_error ("cannot open file for output: %s", filename);
     }
   port = scheme_make_file_output_port (fp);
   ret = scheme_apply_to_list (argv[1], scheme_make_pair (port, scheme_null));
-  fclose (fp);
+  scheme_close_output_port (port);
   return (ret);
 }
 
@@ -489,7 +517,7 @@ with_input_from_file (int argc, Scheme_Object *argv[])
   SCHEME_ASSERT (SCHEME_PROCP (argv[1]),
 		 "with-input-from-file: second arg must be a procedure");
   filename = SCHEME_STR_VAL (argv[0]);
-  fp = fopen (filename, "r");
+  fp = open_file (filename, "r");
   if (! fp)
     {
       scheme_signal_error ("cannot open file for input: %s", filename);
@@ -506,7 +534,6 @@ with_input_from_file (int argc, Scheme_Object *argv[])
 static Scheme_Object *
 with_input_from_string (int argc, Scheme_Object *argv[])
 {
-  char *str;
   Scheme_Object *ret, *old_port, *new_port;
 
   SCHEME_ASSERT ((argc == 2), "with-input-from-string: wrong number of args");
@@ -514,8 +541,8 @@ with_input_from_string (int argc, Scheme_Object *argv[])
 		 "with-input-from-string: first arg must be a string");
   SCHEME_ASSERT (SCHEME_PROCP (argv[1]),
 		 "with-input-from-file: second arg must be a procedure");
-  str = SCHEME_STR_VAL (argv[0]);
-  new_port = scheme_make_string_input_port (str);
+  new_port = scheme_make_string_input_port (SCHEME_STR_VAL (argv[0]),
+					    SCHEME_STR_LEN (argv[0]));
   old_port = cur_in_port;
   cur_in_port = new_port;
   ret = scheme_apply (argv[1], 0, NULL);
@@ -537,7 +564,7 @@ with_output_to_file (int argc, Scheme_Object *argv[])
   SCHEME_ASSERT (SCHEME_PROCP (argv[1]),
 		 "with-output-to-file: second arg must be a procedure");
   filename = SCHEME_STR_VAL (argv[0]);
-  fp = fopen (filename, "w");
+  fp = open_file (filename, "w");
   if (! fp)
     {
       scheme_signal_error ("cannot open file for output: %s", filename);
@@ -557,7 +584,7 @@ open_input_file (int argc, Scheme_Object *argv[])
 
   SCHEME_ASSERT ((argc == 1), "open-input-file: wrong number of args");
   SCHEME_ASSERT (SCHEME_STRINGP(argv[0]), "open-input-file: arg must be a filename");
-  fp = fopen (SCHEME_STR_VAL(argv[0]), "r");
+  fp = open_file (SCHEME_STR_VAL(argv[0]), "r");
   if (!fp)
     {
       scheme_signal_error ("cannot open input file %s", SCHEME_STR_VAL(argv[0]));
@@ -568,12 +595,10 @@ open_input_file (int argc, Scheme_Object *argv[])
 static Scheme_Object *
 open_input_string (int argc, Scheme_Object *argv[])
 {
-  char *str;
-
   SCHEME_ASSERT ((argc == 1), "open-input-string: wrong number of args");
   SCHEME_ASSERT (SCHEME_STRINGP(argv[0]), "open-input-string: arg must be a string");
-  str = SCHEME_STR_VAL (argv[0]);
-  return (scheme_make_string_input_port (str));
+  return (scheme_make_string_input_port (SCHEME_STR_VAL (argv[0]),
+					 SCHEME_STR_LEN (argv[0])));
 }
 
 static Scheme_Object *
@@ -583,7 +608,7 @@ open_output_file (int argc, Scheme_Object *argv[])
 
   SCHEME_ASSERT ((argc == 1), "open-output-file: wrong number of args");
   SCHEME_ASSERT (SCHEME_STRINGP(argv[0]), "open-output-file: arg must be a filename");
-  fp = fopen (SCHEME_STR_VAL(argv[0]), "w");
+  fp = open_file (SCHEME_STR_VAL(argv[0]), "w");
   if (!fp)
     {
       scheme_signal_error ("Cannot open output file %s", SCHEME_STR_VAL(argv[0]));
@@ -770,7 +795,8 @@ static Scheme_Object *
 write_char (int argc, Scheme_Object *argv[])
 {
   Scheme_Object *port;
-  char buf[256];
+  Scheme_Output_Port *op;
+  char ch;
   
   SCHEME_ASSERT ((argc==1 || argc==2), "write-char: wrong number of args");
   if (argc == 2)
@@ -783,8 +809,64 @@ write_char (int argc, Scheme_Object *argv[])
       port = cur_out_port;
     }
   SCHEME_ASSERT (SCHEME_CHARP(argv[0]), "write-char: first arg must be a character");
-  sprintf (buf, "%c", SCHEME_CHAR_VAL (argv[0]));
-  scheme_write_string (buf, port);
+  ch = SCHEME_CHAR_VAL (argv[0]);
+  op = (Scheme_Output_Port *) SCHEME_PTR_VAL (port);
+  (op->write_string_fun) (&ch, 1, op);
+  return (scheme_true);
+}
+
+/* Binary I/O.  These read into and write from a bytevector's own
+   storage; file ports go straight through stdio. */
+
+static Scheme_Object *
+read_bytevector (int argc, Scheme_Object *argv[])
+{
+  Scheme_Object *port;
+  Scheme_Input_Port *ip;
+  unsigned char *buf;
+  int start, end, n, ch;
+
+  SCHEME_ASSERT ((argc >= 1 && argc <= 4), "read-bytevector!: wrong number of args");
+  SCHEME_ASSERT (SCHEME_U8VECTORP (argv[0]), "read-bytevector!: first arg must be a bytevector");
+  scheme_numvec_range ("read-bytevector!", argv[0], argc, argv, 2, &start, &end);
+  buf = SCHEME_U8VEC_ELS (argv[0]) + start;
+  port = (argc > 1) ? argv[1] : cur_in_port;
+  SCHEME_ASSERT (SCHEME_INPORTP (port), "read-bytevector!: second arg must be an input port");
+  ip = (Scheme_Input_Port *) SCHEME_PTR_VAL (port);
+  if (ip->sub_type == scheme_file_input_port_type)
+    {
+      n = fread (buf, 1, end - start, (FILE *) ip->port_data);
+    }
+  else
+    {
+      for ( n=0 ; n<end-start && (ch = scheme_getc (port)) != EOF ; ++n )
+	{
+	  buf[n] = ch;
+	}
+    }
+  if (n == 0 && end > start)
+    {
+      return (scheme_eof);
+    }
+  return (scheme_make_integer (n));
+}
+
+static Scheme_Object *
+write_bytevector (int argc, Scheme_Object *argv[])
+{
+  Scheme_Object *port;
+  Scheme_Output_Port *op;
+  unsigned char *buf;
+  int start, end;
+
+  SCHEME_ASSERT ((argc >= 1 && argc <= 4), "write-bytevector: wrong number of args");
+  SCHEME_ASSERT (SCHEME_U8VECTORP (argv[0]), "write-bytevector: first arg must be a bytevector");
+  scheme_numvec_range ("write-bytevector", argv[0], argc, argv, 2, &start, &end);
+  buf = SCHEME_U8VEC_ELS (argv[0]) + start;
+  port = (argc > 1) ? argv[1] : cur_out_port;
+  SCHEME_ASSERT (SCHEME_OUTPORTP (port), "write-bytevector: second arg must be an output port");
+  op = (Scheme_Output_Port *) SCHEME_PTR_VAL (port);
+  (op->write_string_fun) ((char *) buf, end - start, op);
   return (scheme_true);
 }
 
@@ -799,7 +881,7 @@ load (int argc, Scheme_Object *argv[])
   SCHEME_ASSERT (SCHEME_STRINGP (argv[0]), "load: arg must be a filename (string)");
   filename = SCHEME_STR_VAL (argv[0]);
   printf ("; loading %s\n", filename);
-  fp = fopen (filename, "r");
+  fp = open_file (filename, "r");
   if (! fp)
     {
       scheme_signal_error ("load: could not open file for input: %s", filename);
@@ -813,7 +895,7 @@ load (int argc, Scheme_Object *argv[])
       ret = scheme_eval (obj, scheme_env);
     }
   printf ("; done loading %s\n", filename);
-  fclose (fp);
+  scheme_close_input_port (port);
   return (ret);
 }
 
@@ -35,6 +35,7 @@ static int print (char *str, int index, Scheme_Object *obj, int escaped);
 static int print_string (char *str, int index, Scheme_Object *string, int escaped);
 static int print_pair (char *str, int index, Scheme_Object *pair, int escaped);
 static int print_vector (char *str, int index, Scheme_Object *vec, int escaped);
+static int print_numvec (char *str, int index, Scheme_Object *vec);
 static int print_char (char *str, int index, Scheme_Object *chobj, int escaped);
 
 void
@@ -81,7 +82,7 @@ scheme_write_string (char *str, Scheme_Object *port)
 {
   Scheme_Output_Port *op;
   op = (Scheme_Output_Port *) SCHEME_PTR_VAL (port);
-  (op->write_string_fun) (str, op);
+  (op->write_string_fun) (str, strlen (str), op);
 }
 
 static void 
@@ -91,11 +92,15 @@ print_to_port (Scheme_Object *obj, Scheme_Object *port, int escaped)
   int index = 0;
   
   op = (Scheme_Output_Port *) SCHEME_PTR_VAL (port);
+  if (!escaped && SCHEME_STRINGP (obj))
+    {
+      /* no need to copy it, and it may not fit */
+      (op->write_string_fun) (SCHEME_STR_VAL (obj), SCHEME_STR_LEN (obj), op);
+      return;
+    }
   index = print (print_buffer, index, obj, escaped);
   print_buffer[index] = '\0';
-
-  op = (Scheme_Output_Port *) SCHEME_PTR_VAL (port);
-  (op->write_string_fun) (print_buffer, op);
+  (op->write_string_fun) (print_buffer, index, op);
 }
 
 static int
@@ -140,6 +145,11 @@ print (char *str, int index, Scheme_Object *obj, int escaped)
     {
       index = print_vector (str, index, obj, escaped);
     }
+  else if (type==scheme_u8vector_type || type==scheme_s32vector_type
+	   || type==scheme_f64vector_type)
+    {
+      index = print_numvec (str, index, obj);
+    }
   else if (type==scheme_true_type)
     {
       sprintf ((str + index), "#t");
@@ -161,14 +171,15 @@ print (char *str, int index, Scheme_Object *obj, int escaped)
 static int
 print_string (char *buf, int index, Scheme_Object *string, int escaped)
 {
-  char *str;
+  char *str, *end;
 
   str = SCHEME_STR_VAL (string);
+  end = str + SCHEME_STR_LEN (string);
   if ( escaped )
     {
       buf[index++] = '"';
     }
-  while ( *str )
+  while ( str < end )
     {
       if (escaped && ((*str == '"') || (*str == '\\')))
 	{
@@ -229,6 +240,50 @@ print_vector (char *str, int index, Scheme_Object *vec, int escaped)
   return (index);
 }
 
+static int
+print_numvec (char *str, int index, Scheme_Object *vec)
+{
+  Scheme_Object *type;
+  int i;
+
+  type = SCHEME_TYPE (vec);
+  if (type==scheme_u8vector_type)
+    {
+      sprintf ((str + index), "#u8(");
+    }
+  else if (type==scheme_s32vector_type)
+    {
+      sprintf ((str + index), "#s32(");
+    }
+  else
+    {
+      sprintf ((str + index), "#f64(");
+    }
+  index += strlen (str + index);
+  for ( i=0 ; i<SCHEME_NUMVEC_SIZE(vec) ; ++i )
+    {
+      if (type==scheme_u8vector_type)
+	{
+	  sprintf ((str + index), "%d", SCHEME_U8VEC_ELS(vec)[i]);
+	}
+      else if (type==scheme_s32vector_type)
+	{
+	  sprintf ((str + index), "%d", SCHEME_S32VEC_ELS(vec)[i]);
+	}
+      else
+	{
+	  sprintf ((str + index), "%f", SCHEME_F64VEC_ELS(vec)[i]);
+	}
+      index += strlen (str + index);
+      if (i<SCHEME_NUMVEC_SIZE(vec)-1)
+	{
+	  str[index++] = ' ';
+	}
+    }
+  str[index++] = ')';
+  return (index);
+}
+
 static int
 print_char (char *str, int index, Scheme_Object *charobj, int escaped)
 {
@@ -28,6 +28,7 @@ struct Scheme_Promise
 {
   int forced;
   Scheme_Object *val;
+  Scheme_Code *code;
   Scheme_Env *env;
 };
 typedef struct Scheme_Promise Scheme_Promise;
@@ -41,23 +42,30 @@ static Scheme_Object *force (int argc, Scheme_Object *argv[]);
 void
 scheme_init_promise (Scheme_Env *env)
 {
-  scheme_promise_type = scheme_make_type ("<promise>");
+  scheme_promise_type = scheme_make_layout_type ("<promise>", SCHEME_LAYOUT_PTR1);
   scheme_add_global ("<promise>", scheme_promise_type, env);
   scheme_add_global ("force", scheme_make_prim (force), env);
 }
 
 Scheme_Object *
 scheme_make_promise (Scheme_Object *expr, Scheme_Env *env)
+{
+  return (scheme_make_code_promise (scheme_compile (scheme_analyze (expr, env)), env));
+}
+
+Scheme_Object *
+scheme_make_code_promise (Scheme_Code *code, Scheme_Env *env)
 {
   Scheme_Object *obj;
   Scheme_Promise *promise;
 
+  scheme_capture_env (env);
   promise = (Scheme_Promise *) scheme_malloc (sizeof (Scheme_Promise));
   promise->forced = 0;
-  promise->val = expr;
+  promise->val = NULL;
+  promise->code = code;
   promise->env = env;
-  obj = scheme_alloc_object ();
-  SCHEME_TYPE (obj) = scheme_promise_type;
+  obj = scheme_alloc_typed_object (scheme_promise_type);
   SCHEME_PTR_VAL (obj) = promise;
   return (obj);
 }
@@ -76,7 +84,18 @@ force (int argc, Scheme_Object *argv[])
     }
   else
     {
-      promise->val = scheme_eval (promise->val, promise->env);
+      Scheme_Object *val;
+
+      val = scheme_execute (promise->code, promise->env);
+      /* a promise may be forced again while it is being forced;
+	 the first value to be computed wins */
+      if (! promise->forced)
+	{
+	  promise->val = val;
+	  promise->forced = 1;
+	  promise->code = NULL;
+	  promise->env = NULL;
+	}
       return (promise->val);
     }
 }
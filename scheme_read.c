@@ -219,8 +219,7 @@ read_string (Scheme_Object *port)
 	}
       buf[i++] = ch;
     }
-  buf[i] = '\0';
-  return (scheme_make_string (buf));
+  return (scheme_make_sized_string (buf, i));
 }
 
 /* "'" has been read */
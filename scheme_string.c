@@ -24,6 +24,7 @@
 
 #include "scheme.h"
 #include <string.h>
+#include <ctype.h>
 
 /* globals */
 Scheme_Object *scheme_string_type;
@@ -52,7 +53,8 @@ static Scheme_Object *list_to_string (int argc, Scheme_Object *argv[]);
 static Scheme_Object *string_copy (int argc, Scheme_Object *argv[]);
 static Scheme_Object *string_fill (int argc, Scheme_Object *argv[]);
 
-static int strcmp_ci (char *str1, char *str2);
+static int string_cmp (Scheme_Object *str1, Scheme_Object *str2);
+static int string_cmp_ci (Scheme_Object *str1, Scheme_Object *str2);
 
 void
 scheme_init_string (Scheme_Env *env)
@@ -85,29 +87,37 @@ scheme_init_string (Scheme_Env *env)
 
 Scheme_Object *
 scheme_make_string (char *chars)
+{
+  return (scheme_make_sized_string (chars, strlen (chars)));
+}
+
+Scheme_Object *
+scheme_make_sized_string (char *chars, int len)
 {
   Scheme_Object *str;
   
-  str = scheme_alloc_object ();
-  SCHEME_TYPE (str) = scheme_string_type;
-  SCHEME_STR_VAL (str) = scheme_strdup (chars);
+  str = scheme_alloc_string (len, 0);
+  memcpy (SCHEME_STR_VAL (str), chars, len);
   return (str);
 }
 
+/* The characters of a string follow its object in the same block,
+   and are kept NUL terminated for the C library even though the
+   length is what counts.  The block is not scanned, since it points
+   only at its type, which a global holds, and into itself. */
+
 Scheme_Object *
 scheme_alloc_string (int size, char fill)
 {
   Scheme_Object *str;
-  int i;
   
-  str = scheme_alloc_object ();
-  SCHEME_TYPE (str) = scheme_string_type;
-  SCHEME_STR_VAL (str) = (char *) scheme_malloc (sizeof (char) * (size+1));
-  for ( i=0 ; i<size ; ++i )
-    {
-      SCHEME_STR_VAL(str)[i] = fill;
-    }
-  SCHEME_STR_VAL(str)[i] = '\0';
+  str = (Scheme_Object *) scheme_malloc_atomic (sizeof (Scheme_Object) + size + 1);
+  _SCHEME_TYPE (str) = scheme_string_type;
+  SCHEME_STR_VAL (str) = (char *) (str + 1);
+  SCHEME_STR_LEN (str) = size;
+  SCHEME_STR_SIZE (str) = size;
+  memset (SCHEME_STR_VAL (str), fill, size);
+  SCHEME_STR_VAL (str)[size] = '\0';
   return (str);
 }
 
@@ -163,7 +173,7 @@ string_length (int argc, Scheme_Object *argv[])
 {
   SCHEME_ASSERT ((argc == 1), "string-length: wrong number of args");
   SCHEME_ASSERT (SCHEME_STRINGP (argv[0]), "string-length: arg must be a string");
-  return (scheme_make_integer (strlen (SCHEME_STR_VAL (argv[0]))));
+  return (scheme_make_integer (SCHEME_STR_LEN (argv[0])));
 }
 
 static Scheme_Object *
@@ -176,7 +186,7 @@ string_ref (int argc, Scheme_Object *argv[])
   SCHEME_ASSERT (SCHEME_STRINGP(argv[0]), "string-ref: first arg must be a string");
   SCHEME_ASSERT (SCHEME_INTP(argv[1]), "string-ref: second arg must be an integer");
   str = SCHEME_STR_VAL(argv[0]);
-  len = strlen (str);
+  len = SCHEME_STR_LEN(argv[0]);
   i = SCHEME_INT_VAL(argv[1]);
   if ((i < 0) || (i >= len))
     {
@@ -196,7 +206,7 @@ string_set (int argc, Scheme_Object *argv[])
   SCHEME_ASSERT (SCHEME_INTP(argv[1]), "string-set!: second arg must be an integer");
   SCHEME_ASSERT (SCHEME_CHARP(argv[2]), "string-set!: third arg must be a character");
   str = SCHEME_STR_VAL(argv[0]);
-  len = strlen (str);
+  len = SCHEME_STR_LEN(argv[0]);
   i = SCHEME_INT_VAL(argv[1]);
   if ((i < 0) || (i >= len))
     {
@@ -215,89 +225,64 @@ name (int argc, Scheme_Object *argv[]) \
   SCHEME_ASSERT ((argc == 2), #scheme_name ": wrong number of args"); \
   SCHEME_ASSERT ((SCHEME_STRINGP(argv[0]) && SCHEME_STRINGP(argv[1])), \
                  #scheme_name ": both args must be strings"); \
-  return ((comp (SCHEME_STR_VAL(argv[0]), SCHEME_STR_VAL(argv[1])) op 0) \
+  return ((comp (argv[0], argv[1]) op 0) \
 	  ? scheme_true : scheme_false); \
 }
 
-GEN_STRING_COMP(string_eq, "string=?", strcmp, ==)
-GEN_STRING_COMP(string_ci_eq, "string-ci=?", strcmp_ci, ==)
-GEN_STRING_COMP(string_lt, "string<?", strcmp, <)
-GEN_STRING_COMP(string_gt, "string>?", strcmp, >)
-GEN_STRING_COMP(string_lt_eq, "string<=?", strcmp, <=)
-GEN_STRING_COMP(string_gt_eq, "string>=?", strcmp, >=)
-GEN_STRING_COMP(string_ci_lt, "string-ci<?", strcmp_ci, <)
-GEN_STRING_COMP(string_ci_gt, "string-ci>?", strcmp_ci, >)
-GEN_STRING_COMP(string_ci_lt_eq, "string-ci<=?", strcmp_ci, <=)
-GEN_STRING_COMP(string_ci_gt_eq, "string-ci>=?", strcmp_ci, >=)
+GEN_STRING_COMP(string_eq, "string=?", string_cmp, ==)
+GEN_STRING_COMP(string_ci_eq, "string-ci=?", string_cmp_ci, ==)
+GEN_STRING_COMP(string_lt, "string<?", string_cmp, <)
+GEN_STRING_COMP(string_gt, "string>?", string_cmp, >)
+GEN_STRING_COMP(string_lt_eq, "string<=?", string_cmp, <=)
+GEN_STRING_COMP(string_gt_eq, "string>=?", string_cmp, >=)
+GEN_STRING_COMP(string_ci_lt, "string-ci<?", string_cmp_ci, <)
+GEN_STRING_COMP(string_ci_gt, "string-ci>?", string_cmp_ci, >)
+GEN_STRING_COMP(string_ci_lt_eq, "string-ci<=?", string_cmp_ci, <=)
+GEN_STRING_COMP(string_ci_gt_eq, "string-ci>=?", string_cmp_ci, >=)
 
 static Scheme_Object *
 substring (int argc, Scheme_Object *argv[])
 {
-  int len, start, finish, i;
+  int len, start, finish;
   char *chars;
-  Scheme_Object *str;
 
   SCHEME_ASSERT ((argc == 3), "substring: wrong number of args");
   SCHEME_ASSERT (SCHEME_STRINGP(argv[0]), "substring: first arg must be a string");
   SCHEME_ASSERT (SCHEME_INTP(argv[1]) && SCHEME_INTP(argv[2]),
 		 "substring: second and third args must be integers");
   chars = SCHEME_STR_VAL (argv[0]);
-  len = strlen (chars);
+  len = SCHEME_STR_LEN (argv[0]);
   start = SCHEME_INT_VAL (argv[1]);
   finish = SCHEME_INT_VAL (argv[2]);
   SCHEME_ASSERT ((start >= 0 && start <= len), "substring: first index out of bounds");
   SCHEME_ASSERT ((finish >= start && finish <= len), "substring: second index out of bounds");
-  str = scheme_alloc_string (finish-start, 0);
-  for ( i=0 ; i<finish-start ; ++i )
-    {
-      SCHEME_STR_VAL(str)[i] = chars[i+start];
-    }
-  return (str);
+  return (scheme_make_sized_string (chars + start, finish - start));
 }
 
-static Scheme_Object *append_2 (Scheme_Object *str1, Scheme_Object *str2);
-
 static Scheme_Object *
 string_append (int argc, Scheme_Object *argv[])
 {
   Scheme_Object *new;
-  int i;
+  int len, i;
+  char *chars;
 
-  new = scheme_alloc_string (0, 0);
+  len = 0;
   for ( i=0 ; i<argc ; ++i )
     {
-      new = append_2 (new, argv[i]);
-    }
-  return (new);
-}
-
-static Scheme_Object *
-append_2 (Scheme_Object *str1, Scheme_Object *str2)
-{
-  int len1, len2, i;
-  char *chars1, *chars2;
-  Scheme_Object *new;
-
-  SCHEME_ASSERT (SCHEME_STRINGP(str1) && SCHEME_STRINGP(str2),
-		 "string-append: arguments must be strings");
-  chars1 = SCHEME_STR_VAL (str1);
-  chars2 = SCHEME_STR_VAL (str2);
-  len1 = strlen (chars1);
-  len2 = strlen (chars2);
-  new = scheme_alloc_string (len1+len2, 0);
-  for ( i=0 ; i<len1 ; ++i )
-    {
-      SCHEME_STR_VAL(new)[i] = chars1[i];
+      SCHEME_ASSERT (SCHEME_STRINGP(argv[i]),
+		     "string-append: arguments must be strings");
+      len += SCHEME_STR_LEN (argv[i]);
     }
-  for ( i=0 ; i<len2 ; ++i )
+  new = scheme_alloc_string (len, 0);
+  chars = SCHEME_STR_VAL (new);
+  for ( i=0 ; i<argc ; ++i )
     {
-      SCHEME_STR_VAL(new)[i+len1] = chars2[i];
+      memcpy (chars, SCHEME_STR_VAL (argv[i]), SCHEME_STR_LEN (argv[i]));
+      chars += SCHEME_STR_LEN (argv[i]);
     }
-  SCHEME_STR_VAL(new)[len1+len2] = '\0';
   return (new);
 }
 
-
 static Scheme_Object *
 string_to_list (int argc, Scheme_Object *argv[])
 {
@@ -308,7 +293,7 @@ string_to_list (int argc, Scheme_Object *argv[])
   SCHEME_ASSERT (argc == 1, "string->list: wrong number of args");
   SCHEME_ASSERT (SCHEME_STRINGP(argv[0]), "string->list: arg must be a string");
   chars = SCHEME_STR_VAL(argv[0]);
-  len = strlen (chars);
+  len = SCHEME_STR_LEN(argv[0]);
   first = last = scheme_null;
   for ( i=0 ; i<len ; ++i )
     {
@@ -356,7 +341,7 @@ string_copy (int argc, Scheme_Object *argv[])
 
   SCHEME_ASSERT ((argc == 1), "string-copy: wrong number of args");
   SCHEME_ASSERT (SCHEME_STRINGP (argv[0]), "string-copy: arg must be a string");
-  new = scheme_make_string (SCHEME_STR_VAL (argv[0]));
+  new = scheme_make_sized_string (SCHEME_STR_VAL (argv[0]), SCHEME_STR_LEN (argv[0]));
   return (new);
 }
 
@@ -371,7 +356,7 @@ string_fill (int argc, Scheme_Object *argv[])
   SCHEME_ASSERT (SCHEME_CHARP (argv[1]), "string-fill!: second arg must be a character");
   chars = SCHEME_STR_VAL (argv[0]);
   ch = SCHEME_CHAR_VAL (argv[1]);
-  len = strlen (chars);
+  len = SCHEME_STR_LEN (argv[0]);
   for ( i=0 ; i<len ; ++i )
     {
       chars[i] = ch;
@@ -380,35 +365,41 @@ string_fill (int argc, Scheme_Object *argv[])
 }
 
 static int
-strcmp_ci (char *str1, char *str2)
+string_cmp (Scheme_Object *str1, Scheme_Object *str2)
 {
-  while (*str1 && *str2)
+  int len1, len2, cmp;
+
+  len1 = SCHEME_STR_LEN (str1);
+  len2 = SCHEME_STR_LEN (str2);
+  cmp = memcmp (SCHEME_STR_VAL (str1), SCHEME_STR_VAL (str2),
+		(len1 < len2) ? len1 : len2);
+  if (cmp != 0)
     {
-      if (toupper(*str1) == toupper(*str2))
-	{
-	  *str1++;
-	  *str2++;
-	  continue;
-	}
-      else if (toupper(*str1) < toupper(*str2))
+      return (cmp);
+    }
+  return (len1 - len2);
+}
+
+static int
+string_cmp_ci (Scheme_Object *str1, Scheme_Object *str2)
+{
+  int len1, len2, i;
+  unsigned char *chars1, *chars2;
+
+  len1 = SCHEME_STR_LEN (str1);
+  len2 = SCHEME_STR_LEN (str2);
+  chars1 = (unsigned char *) SCHEME_STR_VAL (str1);
+  chars2 = (unsigned char *) SCHEME_STR_VAL (str2);
+  for ( i=0 ; i<len1 && i<len2 ; ++i )
+    {
+      if (toupper (chars1[i]) < toupper (chars2[i]))
 	{
 	  return -1;
 	}
-      else
+      else if (toupper (chars1[i]) > toupper (chars2[i]))
 	{
 	  return 1;
 	}
     }
-  if (*str1)
-    {
-      return 1;
-    }
-  else if (*str2)
-    {
-      return -1;
-    }
-  else
-    {
-      return 0;
-    }
+  return (len1 - len2);
 }
@@ -53,7 +53,7 @@ static char *setter_name (char *struct_name, char *field_name);
 void
 scheme_init_struct (Scheme_Env *env)
 {
-  scheme_struct_proc_type = scheme_make_type ("<struct-procedure>");
+  scheme_struct_proc_type = scheme_make_layout_type ("<struct-procedure>", SCHEME_LAYOUT_PTR1);
   scheme_add_global ("define-struct", scheme_make_syntax (define_struct_syntax), env);
 }
 
@@ -154,10 +154,7 @@ scheme_make_instance (Scheme_Object *type, int num_fields)
 {
   Scheme_Object *inst;
 
-  inst = scheme_alloc_object ();
-  SCHEME_TYPE (inst) = type;
-  SCHEME_VEC_SIZE (inst) = num_fields;
-  SCHEME_VEC_ELS (inst) = (Scheme_Object **) scheme_malloc (sizeof (Scheme_Object*));
+  inst = scheme_alloc_vector (type, num_fields);
   return (inst);
 }
 
@@ -171,8 +168,7 @@ scheme_make_struct_proc (Scheme_Object *type, int proc_type, int field_num)
   proc->struct_type = type;
   proc->proc_type = proc_type;
   proc->slot_num = field_num;
-  obj = scheme_alloc_object ();
-  SCHEME_TYPE (obj) = scheme_struct_proc_type;
+  obj = scheme_alloc_typed_object (scheme_struct_proc_type);
   SCHEME_PTR_VAL (obj) = proc;
   return (obj);
 }
@@ -209,7 +205,7 @@ type_name (char *struct_name)
 
   orig_len = strlen (struct_name);
   add_len = 2;			/* strlen("<") + strlen(">") */
-  name = (char *) scheme_malloc (sizeof(char) * (orig_len + add_len + 1));
+  name = (char *) scheme_malloc_atomic (sizeof(char) * (orig_len + add_len + 1));
   name[0] = '<';
   name[1] = '\0';
   strcat (name, struct_name);
@@ -226,7 +222,7 @@ constructor_name (char *struct_name)
 
   orig_len = strlen (struct_name);
   make_len = 5;			/* strlen ("make-") */
-  name = (char *) scheme_malloc (sizeof (char) * (orig_len + make_len + 1));
+  name = (char *) scheme_malloc_atomic (sizeof (char) * (orig_len + make_len + 1));
   strcpy (name, "make-");
   strcat (name, struct_name);
   return (name);
@@ -239,7 +235,7 @@ pred_name (char *struct_name)
   char *name;
 
   orig_len = strlen (struct_name);
-  name = (char *) scheme_malloc (sizeof(char) * (orig_len + 1 + 1));
+  name = (char *) scheme_malloc_atomic (sizeof(char) * (orig_len + 1 + 1));
   strcpy (name, struct_name);
   name[orig_len] = '?';
   name[orig_len+1] = '\0';
@@ -255,7 +251,7 @@ getter_name (char *struct_name, char *field_name)
   name_len = strlen (struct_name);
   field_len = strlen (field_name);
   dash_len = 1;			/* strlen ("-") */
-  name = (char *) scheme_malloc (sizeof (char) * (name_len + dash_len + field_len + 1));
+  name = (char *) scheme_malloc_atomic (sizeof (char) * (name_len + dash_len + field_len + 1));
   strcpy (name, struct_name);
   strcat (name, "-");
   strcat (name, field_name);
@@ -274,7 +270,7 @@ setter_name (char *struct_name, char *field_name)
   dash_len = 1;			/* strlen ("-") */
   bang_len = 1;			/* strlen ("!") */
   name = (char *) 
-    scheme_malloc (sizeof (char)*(set_len + name_len + dash_len + field_len + bang_len + 1));
+    scheme_malloc_atomic (sizeof (char)*(set_len + name_len + dash_len + field_len + bang_len + 1));
   strcpy (name, "set-");
   strcat (name, struct_name);
   strcat (name, "-");
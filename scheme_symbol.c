@@ -40,13 +40,12 @@ static Scheme_Object *symbol_p_prim (int argc, Scheme_Object *argv[]);
 static Scheme_Object *string_to_symbol_prim (int argc, Scheme_Object *argv[]);
 static Scheme_Object *symbol_to_string_prim (int argc, Scheme_Object *argv[]);
 static char *downcase (char *str);
+static Scheme_Object *intern_exact_symbol (char *name);
 
 void
 scheme_init_symbol (Scheme_Env *env)
 {
-  scheme_symbol_type = scheme_make_type ("<symbol>");
   scheme_add_global ("<symbol>", scheme_symbol_type, env);
-  symbol_table = scheme_hash_table (HASH_TABLE_SIZE);
   scheme_quote_symbol = scheme_intern_symbol ("quote");
   scheme_quasiquote_symbol = scheme_intern_symbol ("quasiquote");
   scheme_unquote_symbol = scheme_intern_symbol ("unquote");
@@ -62,17 +61,32 @@ scheme_make_symbol (char *name)
   Scheme_Object *sym;
 
   sym = scheme_alloc_object ();
-  SCHEME_TYPE (sym) = scheme_symbol_type;
+  _SCHEME_TYPE (sym) = scheme_symbol_type;
   SCHEME_STR_VAL (sym) = scheme_strdup (name);
+  SCHEME_SYM_GLOBAL (sym) = NULL;
   return (sym);
 }
 
 Scheme_Object *
 scheme_intern_symbol (char *name)
+{
+  return (intern_exact_symbol (downcase (name)));
+}
+
+/* locals */
+
+static Scheme_Object *
+intern_exact_symbol (char *name)
 {
   Scheme_Object *sym;
 
-  name = downcase (name);
+  /* globals are bound in symbols, so the table has to exist before
+     the first call to scheme_add_global() */
+  if (! symbol_table)
+    {
+      symbol_table = scheme_hash_table (HASH_TABLE_SIZE);
+      scheme_symbol_type = scheme_make_type ("<symbol>");
+    }
   sym = (Scheme_Object *)scheme_lookup_in_table (symbol_table, name);
   if (sym)
     {
@@ -86,8 +100,6 @@ scheme_intern_symbol (char *name)
     }
 }
 
-/* locals */
-
 static Scheme_Object *
 symbol_p_prim (int argc, Scheme_Object *argv[])
 {
@@ -100,7 +112,7 @@ string_to_symbol_prim (int argc, Scheme_Object *argv[])
 {
   SCHEME_ASSERT ((argc == 1), "string->symbol: wrong number of args");
   SCHEME_ASSERT (SCHEME_STRINGP(argv[0]), "string->symbol: arg must be string");
-  return (scheme_make_symbol (SCHEME_STR_VAL(argv[0])));
+  return (intern_exact_symbol (SCHEME_STR_VAL(argv[0])));
 }
 
 static Scheme_Object *
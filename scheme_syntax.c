@@ -29,24 +29,30 @@ Scheme_Object *scheme_syntax_type;
 Scheme_Object *scheme_macro_type;
 
 /* locals */
-static Scheme_Object *lambda_syntax (Scheme_Object *form, Scheme_Env *env);
-static Scheme_Object *define_syntax (Scheme_Object *form, Scheme_Env *env);
-static Scheme_Object *quote_syntax (Scheme_Object *form, Scheme_Env *env);
-static Scheme_Object *if_syntax (Scheme_Object *form, Scheme_Env *env);
-static Scheme_Object *set_syntax (Scheme_Object *form, Scheme_Env *env);
-static Scheme_Object *cond_syntax (Scheme_Object *form, Scheme_Env *env);
-static Scheme_Object *case_syntax (Scheme_Object *form, Scheme_Env *env);
-static Scheme_Object *and_syntax (Scheme_Object *form, Scheme_Env *env);
-static Scheme_Object *or_syntax (Scheme_Object *form, Scheme_Env *env);
-static Scheme_Object *let_syntax (Scheme_Object *form, Scheme_Env *env);
-static Scheme_Object *let_star_syntax (Scheme_Object *form, Scheme_Env *env);
-static Scheme_Object *letrec_syntax (Scheme_Object *form, Scheme_Env *env);
-static Scheme_Object *begin_syntax (Scheme_Object *form, Scheme_Env *env);
-static Scheme_Object *do_syntax (Scheme_Object *form, Scheme_Env *env);
-static Scheme_Object *delay_syntax (Scheme_Object *form, Scheme_Env *env);
-static Scheme_Object *quasiquote_syntax (Scheme_Object *form, Scheme_Env *env);
+static Scheme_Node *lambda_syntax (Scheme_Object *form, Scheme_Env *env);
+static Scheme_Node *define_syntax (Scheme_Object *form, Scheme_Env *env);
+static Scheme_Node *quote_syntax (Scheme_Object *form, Scheme_Env *env);
+static Scheme_Node *if_syntax (Scheme_Object *form, Scheme_Env *env);
+static Scheme_Node *set_syntax (Scheme_Object *form, Scheme_Env *env);
+static Scheme_Node *cond_syntax (Scheme_Object *form, Scheme_Env *env);
+static Scheme_Node *case_syntax (Scheme_Object *form, Scheme_Env *env);
+static Scheme_Node *and_syntax (Scheme_Object *form, Scheme_Env *env);
+static Scheme_Node *or_syntax (Scheme_Object *form, Scheme_Env *env);
+static Scheme_Node *let_syntax (Scheme_Object *form, Scheme_Env *env);
+static Scheme_Node *let_star_syntax (Scheme_Object *form, Scheme_Env *env);
+static Scheme_Node *letrec_syntax (Scheme_Object *form, Scheme_Env *env);
+static Scheme_Node *begin_syntax (Scheme_Object *form, Scheme_Env *env);
+static Scheme_Node *do_syntax (Scheme_Object *form, Scheme_Env *env);
+static Scheme_Node *delay_syntax (Scheme_Object *form, Scheme_Env *env);
+static Scheme_Node *quasiquote_syntax (Scheme_Object *form, Scheme_Env *env);
 /* non-standard */
-static Scheme_Object *defmacro_syntax (Scheme_Object *form, Scheme_Env *env);
+static Scheme_Node *defmacro_syntax (Scheme_Object *form, Scheme_Env *env);
+
+static Scheme_Node *analyze_lambda (Scheme_Object *params, Scheme_Object *forms, Scheme_Env *env);
+static Scheme_Node *analyze_body (Scheme_Object *forms, Scheme_Env *env);
+static Scheme_Node *analyze_sequence (Scheme_Object *forms, Scheme_Env *env);
+static Scheme_Object **binding_symbols (Scheme_Object *bindings, int num, char *who);
+static Scheme_Node **binding_inits (Scheme_Object *bindings, int num, Scheme_Env *env);
 
 /* symbols */
 static Scheme_Object *scheme_quasiquote;
@@ -54,38 +60,53 @@ static Scheme_Object *scheme_unquote;
 static Scheme_Object *scheme_unquote_splicing;
 static Scheme_Object *scheme_define;
 static Scheme_Object *scheme_lambda;
+static Scheme_Object *scheme_else;
+static Scheme_Object *scheme_arrow;
+
+/* quasiquote helpers */
+static Scheme_Object *quasi_cons;
+static Scheme_Object *quasi_append;
+static Scheme_Object *quasi_vector;
+static Scheme_Object *quasi_cons_prim (int argc, Scheme_Object *argv[]);
+static Scheme_Object *quasi_append_prim (int argc, Scheme_Object *argv[]);
+static Scheme_Object *quasi_vector_prim (int argc, Scheme_Object *argv[]);
 
 #define CONS(a,b) scheme_make_pair(a,b)
 
 void 
 scheme_init_syntax (Scheme_Env *env)
 {
-  scheme_syntax_type = scheme_make_type ("<syntax>");
+  scheme_syntax_type = scheme_make_layout_type ("<syntax>", SCHEME_LAYOUT_NONE);
   scheme_add_global ("<syntax>", scheme_syntax_type, env);
-  scheme_macro_type = scheme_make_type ("<macro>");
+  scheme_macro_type = scheme_make_layout_type ("<macro>", SCHEME_LAYOUT_PTR1);
   scheme_add_global ("<macro>", scheme_macro_type, env);
   scheme_quasiquote = scheme_intern_symbol ("quasiquote");
   scheme_unquote = scheme_intern_symbol ("unquote");
   scheme_unquote_splicing = scheme_intern_symbol ("unquote-splicing");
   scheme_define = scheme_intern_symbol ("define");
   scheme_lambda = scheme_intern_symbol ("lambda");
-  scheme_add_global ("lambda", scheme_make_syntax (lambda_syntax), env);
-  scheme_add_global ("define", scheme_make_syntax (define_syntax), env);
-  scheme_add_global ("quote", scheme_make_syntax (quote_syntax), env);
-  scheme_add_global ("if", scheme_make_syntax (if_syntax), env);
-  scheme_add_global ("set!", scheme_make_syntax (set_syntax), env);
-  scheme_add_global ("cond", scheme_make_syntax (cond_syntax), env);
-  scheme_add_global ("case", scheme_make_syntax (case_syntax), env);
-  scheme_add_global ("and", scheme_make_syntax (and_syntax), env);
-  scheme_add_global ("or", scheme_make_syntax (or_syntax), env);
-  scheme_add_global ("let", scheme_make_syntax (let_syntax), env);
-  scheme_add_global ("let*", scheme_make_syntax (let_star_syntax), env);
-  scheme_add_global ("letrec", scheme_make_syntax (letrec_syntax), env);
-  scheme_add_global ("begin", scheme_make_syntax (begin_syntax), env);
-  scheme_add_global ("do", scheme_make_syntax (do_syntax), env);
-  scheme_add_global ("delay", scheme_make_syntax (delay_syntax), env);
-  scheme_add_global ("quasiquote", scheme_make_syntax (quasiquote_syntax), env);
-  scheme_add_global ("defmacro", scheme_make_syntax (defmacro_syntax), env);
+  scheme_else = scheme_intern_symbol ("else");
+  scheme_arrow = scheme_intern_symbol ("=>");
+  quasi_cons = scheme_make_prim (quasi_cons_prim);
+  quasi_append = scheme_make_prim (quasi_append_prim);
+  quasi_vector = scheme_make_prim (quasi_vector_prim);
+  scheme_add_global ("lambda", scheme_make_syntax_analyzer (lambda_syntax), env);
+  scheme_add_global ("define", scheme_make_syntax_analyzer (define_syntax), env);
+  scheme_add_global ("quote", scheme_make_syntax_analyzer (quote_syntax), env);
+  scheme_add_global ("if", scheme_make_syntax_analyzer (if_syntax), env);
+  scheme_add_global ("set!", scheme_make_syntax_analyzer (set_syntax), env);
+  scheme_add_global ("cond", scheme_make_syntax_analyzer (cond_syntax), env);
+  scheme_add_global ("case", scheme_make_syntax_analyzer (case_syntax), env);
+  scheme_add_global ("and", scheme_make_syntax_analyzer (and_syntax), env);
+  scheme_add_global ("or", scheme_make_syntax_analyzer (or_syntax), env);
+  scheme_add_global ("let", scheme_make_syntax_analyzer (let_syntax), env);
+  scheme_add_global ("let*", scheme_make_syntax_analyzer (let_star_syntax), env);
+  scheme_add_global ("letrec", scheme_make_syntax_analyzer (letrec_syntax), env);
+  scheme_add_global ("begin", scheme_make_syntax_analyzer (begin_syntax), env);
+  scheme_add_global ("do", scheme_make_syntax_analyzer (do_syntax), env);
+  scheme_add_global ("delay", scheme_make_syntax_analyzer (delay_syntax), env);
+  scheme_add_global ("quasiquote", scheme_make_syntax_analyzer (quasiquote_syntax), env);
+  scheme_add_global ("defmacro", scheme_make_syntax_analyzer (defmacro_syntax), env);
 }
 
 Scheme_Object *
@@ -93,333 +114,224 @@ scheme_make_syntax (Scheme_Syntax *proc)
 {
   Scheme_Object *syntax;
 
-  syntax = scheme_alloc_object ();
-  SCHEME_TYPE (syntax) = scheme_syntax_type;
+  syntax = scheme_alloc_typed_object (scheme_syntax_type);
   SCHEME_SYNTAX (syntax) = proc;
+  SCHEME_ANALYZER (syntax) = NULL;
+  return (syntax);
+}
+
+Scheme_Object *
+scheme_make_syntax_analyzer (Scheme_Analyzer *analyzer)
+{
+  Scheme_Object *syntax;
+
+  syntax = scheme_alloc_typed_object (scheme_syntax_type);
+  SCHEME_SYNTAX (syntax) = NULL;
+  SCHEME_ANALYZER (syntax) = analyzer;
   return (syntax);
 }
 
-/* builtin syntax */
+/* builtin syntax
 
-static Scheme_Object *
+   Each of these analyzes its form once, in the scope given by env,
+   and returns the node that scheme_execute() will run. */
+
+static Scheme_Node *
 lambda_syntax (Scheme_Object *form, Scheme_Env *env)
 {
-  Scheme_Object *params;
-
   SCHEME_ASSERT (SCHEME_PAIRP(form), "badly formed lambda");
   SCHEME_ASSERT (SCHEME_PAIRP(SCHEME_CDR(form)), "badly formed lambda");
-  return (scheme_make_closure (env, SCHEME_CDR(form)));
+  return (analyze_lambda (SCHEME_CADR (form), SCHEME_CDDR (form), env));
 }
 
-static Scheme_Object *
+static Scheme_Node *
 define_syntax (Scheme_Object *form, Scheme_Env *env)
 {
-  Scheme_Object *var, *val, *sec, *params, *forms;
+  Scheme_Object *var, *sec;
+  Scheme_Node *node, *val;
 
+  SCHEME_ASSERT (SCHEME_PAIRP (SCHEME_CDR (form)), "badly formed define");
   sec = SCHEME_CAR (SCHEME_CDR (form));
+  SCHEME_ASSERT ((SCHEME_PAIRP (sec) || SCHEME_SYMBOLP (sec)),
+		 "define: second arg must be symbol or list");
 
-  if (SCHEME_TYPE(sec) == scheme_pair_type)
+  if (SCHEME_PAIRP (sec))
     {
       var = SCHEME_CAR (sec);
-      params = SCHEME_CDR (sec);
-      forms = SCHEME_CDR (SCHEME_CDR (form));
-      val = scheme_make_closure (env, scheme_make_pair (params, forms));
-    }
-  else if (SCHEME_TYPE(sec) == scheme_symbol_type)
-    {
-      var = sec;
-      val = SCHEME_CAR (SCHEME_CDR (SCHEME_CDR (form)));
-      val = scheme_eval (val, env);
+      val = analyze_lambda (SCHEME_CDR (sec), SCHEME_CDDR (form), env);
     }
   else
     {
-      scheme_signal_error ("define: second arg must be symbol or list");
-    }
-  scheme_add_global (SCHEME_STR_VAL(var), val, env);
-  return (var);
+      var = sec;
+      SCHEME_ASSERT (SCHEME_PAIRP (SCHEME_CDDR (form)), "define: no value for variable");
+      val = scheme_analyze (SCHEME_CAR (SCHEME_CDDR (form)), env);
+    }
+  SCHEME_ASSERT (SCHEME_SYMBOLP (var), "define: variable must be a symbol");
+  node = scheme_make_node (SCHEME_DEFINE_NODE);
+  node->obj = var;
+  node->a = val;
+  return (node);
 }
 
-static Scheme_Object *
+static Scheme_Node *
 quote_syntax (Scheme_Object *form, Scheme_Env *env)
 {
   SCHEME_ASSERT ((scheme_list_length (form) == 2), "quote: wrong number of args");
-  return (SCHEME_CAR (SCHEME_CDR (form)));
+  return (scheme_make_const_node (SCHEME_CAR (SCHEME_CDR (form))));
 }
 
-static Scheme_Object *
+static Scheme_Node *
 if_syntax (Scheme_Object *form, Scheme_Env *env)
 {
   int len;
-  Scheme_Object *test, *thenp, *elsep;
+  Scheme_Node *node;
 
   len = scheme_list_length (form);
   SCHEME_ASSERT (((len == 3) || (len == 4)), "badly formed `if' form");
-  test = SCHEME_CAR (SCHEME_CDR (form));
-  test = scheme_eval (test, env);
-  if (test != scheme_false)
+  form = SCHEME_CDR (form);
+  node = scheme_make_node (SCHEME_IF_NODE);
+  node->a = scheme_analyze (SCHEME_CAR (form), env);
+  node->b = scheme_analyze (SCHEME_CADR (form), env);
+  if (len == 4)
     {
-      thenp = SCHEME_CAR (SCHEME_CDR (SCHEME_CDR (form)));
-      return (scheme_eval (thenp, env));
-    }
-  else
-    {
-      if (len == 4)
-	{
-	  elsep = SCHEME_CAR (SCHEME_CDR (SCHEME_CDR ((SCHEME_CDR (form)))));
-	  return (scheme_eval (elsep, env));
-	}
-      else
-	{
-	  return (scheme_false);
-	}
+      node->c = scheme_analyze (SCHEME_CAR (SCHEME_CDDR (form)), env);
     }
+  return (node);
 }
 
-static Scheme_Object *
+static Scheme_Node *
 set_syntax (Scheme_Object *form, Scheme_Env *env)
 {
-  Scheme_Object *var, *val;
+  Scheme_Object *var;
+  Scheme_Node *node;
 
   SCHEME_ASSERT ((scheme_list_length (form) == 3), "bad set! form");
   var = SCHEME_CAR (SCHEME_CDR (form));
   SCHEME_ASSERT (SCHEME_TYPE (var) == scheme_symbol_type,
 		 "second arg to `set!' must be symbol");
-  val = scheme_eval (SCHEME_CAR (SCHEME_CDR (SCHEME_CDR (form))), env);
-  scheme_set_value (var, val, env);
-  return (val);
+  node = scheme_make_node (SCHEME_SET_NODE);
+  if (scheme_lexical_address (var, env, &node->depth, &node->index))
+    {
+      node->kind = SCHEME_LOCAL_SET_NODE;
+    }
+  node->obj = var;
+  node->a = scheme_analyze (SCHEME_CAR (SCHEME_CDR (SCHEME_CDR (form))), env);
+  return (node);
 }
 
-static Scheme_Object *
+static Scheme_Node *
 cond_syntax (Scheme_Object *form, Scheme_Env *env)
 {
-  Scheme_Object *clauses, *clause, *test, *forms, *ret;
+  Scheme_Object *clauses, *clause, *forms;
+  Scheme_Node *node, *cnode;
+  int i;
 
   clauses = SCHEME_CDR (form);
-  ret = scheme_false;
-  while (clauses != scheme_null)
+  node = scheme_make_node (SCHEME_COND_NODE);
+  node->num = scheme_list_length (clauses);
+  node->nodes = (Scheme_Node **) scheme_malloc ((node->num + 1) * sizeof (Scheme_Node *));
+  for ( i=0 ; i<node->num ; ++i )
     {
       clause = SCHEME_CAR (clauses);
-      test = SCHEME_CAR (clause);
-      if (test == scheme_intern_symbol ("else"))
+      SCHEME_ASSERT (SCHEME_PAIRP (clause), "cond: bad clause");
+      cnode = scheme_make_node (SCHEME_CLAUSE_NODE);
+      if (SCHEME_CAR (clause) != scheme_else)
 	{
-	  test = scheme_true;
+	  cnode->a = scheme_analyze (SCHEME_CAR (clause), env);
 	}
-      else
+      forms = SCHEME_CDR (clause);
+      if (!SCHEME_NULLP (forms) && (SCHEME_CAR (forms) == scheme_arrow))
 	{
-	  test = scheme_eval (test, env);
+	  forms = SCHEME_CDR (forms);
+	  SCHEME_ASSERT (SCHEME_PAIRP (forms), "cond: bad `=>' clause");
+	  cnode->flags = SCHEME_ARROW_CLAUSE;
+	  cnode->b = scheme_analyze (SCHEME_CAR (forms), env);
 	}
-      if (test != scheme_false)
+      else if (!SCHEME_NULLP (forms))
 	{
-	  forms = SCHEME_CDR (clause);
-	  if (!SCHEME_NULLP (forms) && 
-	      (SCHEME_CAR(forms) == scheme_intern_symbol ("=>")))
-	    {
-	      Scheme_Object *proc;
-
-	      forms = SCHEME_CDR (forms);
-	      SCHEME_ASSERT (!SCHEME_NULLP(forms), "cond: bad `=>' clause");
-	      proc = scheme_eval (SCHEME_CAR (forms), env);
-	      SCHEME_ASSERT (SCHEME_PROCP(proc), "cond: form after `=>' must evaluate to a procedure");
-	      ret = scheme_apply_to_list (proc, scheme_make_pair (test, scheme_null));
-	    }
-	  else
-	    {
-	      while (forms != scheme_null)
-		{
-		  ret = scheme_eval (SCHEME_CAR (forms), env);
-		  forms = SCHEME_CDR (forms);
-		}
-	    }
-	  return (ret);
+	  cnode->b = analyze_sequence (forms, env);
 	}
+      node->nodes[i] = cnode;
       clauses = SCHEME_CDR (clauses);
     }
-  return (ret);
+  return (node);
 }
 
-static Scheme_Object *
+static Scheme_Node *
 case_syntax (Scheme_Object *form, Scheme_Env *env)
 {
-  Scheme_Object *key, *clauses, *clause;
-  Scheme_Object *data, *exprs, *res;
+  Scheme_Object *clauses, *clause, *data;
+  Scheme_Node *node, *cnode;
+  int i;
 
-  key = SCHEME_CAR (SCHEME_CDR (form));
+  SCHEME_ASSERT ((scheme_list_length (form) >= 2), "badly formed `case' form");
+  node = scheme_make_node (SCHEME_CASE_NODE);
+  node->a = scheme_analyze (SCHEME_CAR (SCHEME_CDR (form)), env);
   clauses = SCHEME_CDR (SCHEME_CDR (form));
-
-  key = scheme_eval (key, env);
-  while (! SCHEME_NULLP (clauses))
+  node->num = scheme_list_length (clauses);
+  node->nodes = (Scheme_Node **) scheme_malloc ((node->num + 1) * sizeof (Scheme_Node *));
+  for ( i=0 ; i<node->num ; ++i )
     {
       clause = SCHEME_CAR (clauses);
+      SCHEME_ASSERT (SCHEME_PAIRP (clause), "case: bad clause");
       data = SCHEME_CAR (clause);
-      if (SCHEME_SYMBOLP (data) && (scheme_intern_symbol("else") == data))
-	{
-	  exprs = SCHEME_CDR (clause);
-	  while (! SCHEME_NULLP (exprs))
-	    {
-	      res = scheme_eval (SCHEME_CAR (exprs), env);
-	      exprs = SCHEME_CDR (exprs);
-	    }
-	  return (res);
-	}
-      SCHEME_ASSERT (SCHEME_PAIRP(data), "case: first thing in clause must be a list");
-      while (! SCHEME_NULLP (data))
+      cnode = scheme_make_node (SCHEME_CASE_CLAUSE_NODE);
+      if (data != scheme_else)
 	{
-	  if (scheme_eqv (SCHEME_CAR (data), key))
-	    {
-	      exprs = SCHEME_CDR (clause);
-	      while (! SCHEME_NULLP (exprs))
-		{
-		  res = scheme_eval (SCHEME_CAR (exprs), env);
-		  exprs = SCHEME_CDR (exprs);
-		}
-	      return (res);
-	    }
-	  data = SCHEME_CDR (data);
+	  SCHEME_ASSERT (SCHEME_PAIRP(data), "case: first thing in clause must be a list");
+	  cnode->obj = data;
 	}
+      cnode->b = analyze_sequence (SCHEME_CDR (clause), env);
+      node->nodes[i] = cnode;
       clauses = SCHEME_CDR (clauses);
     }
-  return (scheme_false);
+  return (node);
 }
 
-static Scheme_Object *
+static Scheme_Node *
 and_syntax (Scheme_Object *form, Scheme_Env *env)
 {
-  Scheme_Object *forms, *ret;
+  Scheme_Node *node;
 
-  forms = SCHEME_CDR (form);
-  ret = scheme_true;
-  while (forms != scheme_null)
-    {
-      ret = scheme_eval (SCHEME_CAR (forms), env);
-      if (ret == scheme_false)
-	{
-	  return (scheme_false);
-	}
-      forms = SCHEME_CDR (forms);
-    }
-  return (ret);
+  node = scheme_make_node (SCHEME_AND_NODE);
+  node->num = scheme_list_length (SCHEME_CDR (form));
+  node->nodes = scheme_analyze_list (SCHEME_CDR (form), node->num, env);
+  return (node);
 }
 
-static Scheme_Object *
+static Scheme_Node *
 or_syntax (Scheme_Object *form, Scheme_Env *env)
 {
-  Scheme_Object *forms, *ret;
+  Scheme_Node *node;
 
-  forms = SCHEME_CDR (form);
-  ret = scheme_false;
-  while (forms != scheme_null)
-    {
-      ret = scheme_eval (SCHEME_CAR (forms), env);
-      if (ret != scheme_false)
-	{
-	  return (ret);
-	}
-      forms = SCHEME_CDR (forms);
-    }
-  return (ret);
+  node = scheme_make_node (SCHEME_OR_NODE);
+  node->num = scheme_list_length (SCHEME_CDR (form));
+  node->nodes = scheme_analyze_list (SCHEME_CDR (form), node->num, env);
+  return (node);
 }
 
 static int internal_def_p (Scheme_Object *form);
-static Scheme_Object *named_let_syntax (Scheme_Object *form, Scheme_Env *env);
+static Scheme_Node *named_let_syntax (Scheme_Object *form, Scheme_Env *env);
 
-static Scheme_Object *
+static Scheme_Node *
 let_syntax (Scheme_Object *form, Scheme_Env *env)
 {
-  Scheme_Object *bindings, *binding, *vars, *vals, *ev_vals, *forms, *ret;
-  Scheme_Object *vars_last, *vals_last, *pair, *aform;
-  int num_int_defs, num_bindings, i;
-  Scheme_Env *frame;
+  Scheme_Object *bindings;
+  Scheme_Node *node;
 
+  SCHEME_ASSERT ((scheme_list_length(form) >= 3), "badly formed `let' form");
   if (SCHEME_SYMBOLP (SCHEME_CAR (SCHEME_CDR (form))))
     {
       return (named_let_syntax (form, env));
     }
-  SCHEME_ASSERT ((scheme_list_length(form) >= 3), "badly formed `let' form");
   bindings = SCHEME_CAR (SCHEME_CDR (form));
-  num_bindings = scheme_list_length (bindings);
-  frame = scheme_new_frame (num_bindings);
-  for ( i=0 ; i<num_bindings; ++i )
-    {
-      binding = SCHEME_CAR (bindings);
-      scheme_add_binding (i, SCHEME_CAR (binding), scheme_eval (SCHEME_CADR (binding), env), frame);
-      bindings = SCHEME_CDR (bindings);
-    }
-  env = scheme_extend_env (frame, env);
-  forms = SCHEME_CDR (SCHEME_CDR (form));
-
-  /* process internal defines */
-  num_int_defs = 0;
-  vars = vals = vars_last = vals_last = scheme_null;
-  while (!SCHEME_NULLP(forms) && internal_def_p (SCHEME_CAR(forms)))
-    {
-      num_int_defs++;
-      aform = SCHEME_CAR (forms);
-      /* get var */
-      if (SCHEME_PAIRP (SCHEME_CAR (SCHEME_CDR (aform))))
-	{
-	  pair = scheme_make_pair (SCHEME_CAR (SCHEME_CAR (SCHEME_CDR (aform))), scheme_null);
-	}
-      else
-	{
-	  pair = scheme_make_pair (SCHEME_CAR (SCHEME_CDR (aform)), scheme_null);
-	}
-      if (SCHEME_NULLP (vars))
-	{
-	  vars = vars_last = pair;
-	}
-      else
-	{
-	  SCHEME_CDR (vars_last) = pair;
-	  vars_last = pair;
-	}
-      /* get val */
-      if (SCHEME_PAIRP (SCHEME_CAR (SCHEME_CDR (aform))))
-	{
-	  pair = CONS (CONS (scheme_lambda, CONS (SCHEME_CDR (SCHEME_CAR (SCHEME_CDR (aform))),
-						  SCHEME_CDR (SCHEME_CDR (aform)))),
-		       scheme_null);
-	}
-      else
-	{
-	  pair = scheme_make_pair (SCHEME_CAR (SCHEME_CDR (SCHEME_CDR (aform))), scheme_null);
-	}
-      if (SCHEME_NULLP (vals))
-	{
-	  vals = vals_last = pair;
-	}
-      else
-	{
-	  SCHEME_CDR (vals_last) = pair;
-	  vals_last = pair;
-	}
-      forms = SCHEME_CDR (forms);
-    }
-  if ( num_int_defs )
-    {
-      env = scheme_add_frame (vars, scheme_alloc_list (num_int_defs), env);
-      while (! SCHEME_NULLP (vars))
-	{
-	  scheme_set_value (SCHEME_CAR(vars),
-			    scheme_eval (SCHEME_CAR (vals), env),
-			    env);
-	  vars = SCHEME_CDR (vars);
-	  vals = SCHEME_CDR (vals);
-	}
-    }
-
-  while (forms != scheme_null)
-    {
-      ret = scheme_eval (SCHEME_CAR (forms), env);
-      forms = SCHEME_CDR (forms);
-    }
-  /* pop internal define frame */
-  if ( num_int_defs )
-    {
-      env = scheme_pop_frame (env);
-    }
-  /* pop regular binding frame */
-  env = scheme_pop_frame (env);
-  return (ret);
+  node = scheme_make_node (SCHEME_LET_NODE);
+  node->num = scheme_list_length (bindings);
+  node->syms = binding_symbols (bindings, node->num, "let");
+  node->nodes = binding_inits (bindings, node->num, env);
+  env = scheme_new_scope (node->num, node->syms, env);
+  node->a = analyze_body (SCHEME_CDR (SCHEME_CDR (form)), env);
+  return (node);
 }
 
 static int 
@@ -428,381 +340,183 @@ internal_def_p (Scheme_Object *form)
   return (SCHEME_PAIRP(form) && (SCHEME_CAR(form) == scheme_define));
 }
 
-static Scheme_Object *
+static Scheme_Node *
 named_let_syntax (Scheme_Object *form, Scheme_Env *env)
 {
-  Scheme_Object *name, *bindings, *vars, *vals, *forms;
-  Scheme_Object *proc, *init, *ret;
+  Scheme_Object *name, *bindings, *vars;
+  Scheme_Node *node;
 
+  SCHEME_ASSERT ((scheme_list_length(form) >= 4), "badly formed named `let' form");
   name = SCHEME_CAR (SCHEME_CDR (form));
   bindings = SCHEME_CAR (SCHEME_CDR (SCHEME_CDR (form)));
   vars = scheme_map_1 (scheme_car, bindings);
-  vals = scheme_map_1 (scheme_cadr, bindings);
-  forms = SCHEME_CDR (SCHEME_CDR (SCHEME_CDR (form)));
-
-  proc = CONS(scheme_intern_symbol ("lambda"), CONS(vars, forms));
-  init = CONS(name, vals);
 
-  env = scheme_add_frame (CONS(name, scheme_null), CONS(scheme_null, scheme_null), env);
-  proc = scheme_eval (proc, env);
-  scheme_set_value (name, proc, env);
-  ret = scheme_eval (init, env);
-  env = scheme_pop_frame (env);
-  return (ret);
+  node = scheme_make_node (SCHEME_NAMED_LET_NODE);
+  node->num = scheme_list_length (bindings);
+  node->syms = (Scheme_Object **) scheme_malloc (sizeof (Scheme_Object *));
+  node->syms[0] = name;
+  node->nodes = binding_inits (bindings, node->num, env);
+  env = scheme_new_scope (1, node->syms, env);
+  node->a = analyze_lambda (vars, SCHEME_CDR (SCHEME_CDR (SCHEME_CDR (form))), env);
+  return (node);
 }
 
-static Scheme_Object *
-let_star_syntax (Scheme_Object *form, Scheme_Env *env)
+static Scheme_Node *
+analyze_let_star (Scheme_Object *bindings, Scheme_Object *forms, Scheme_Env *env)
 {
-  Scheme_Object *bindings, *vars, *vals, *ev_vals, *forms, *ret;
-  Scheme_Object *vars_last, *vals_last, *pair, *aform;
-  Scheme_Env *frame;
-  int num_int_defs, num_bindings, i;
+  Scheme_Node *node;
 
-  SCHEME_ASSERT ((scheme_list_length(form) >= 3), "badly formed `let*' form");
-  bindings = SCHEME_CAR (SCHEME_CDR (form));
-  num_bindings = scheme_list_length (bindings);
-  vars = scheme_map_1 (scheme_car, bindings);
-  vals = scheme_map_1 (scheme_cadr, bindings);
-  frame = scheme_new_frame (num_bindings);
-
-  /* first install dummy bindings */
-  for ( i=0 ; i < num_bindings ; ++i )
-    {
-      scheme_add_binding (i, scheme_false, scheme_false, frame);
-    }
-  env = scheme_extend_env (frame, env);
-  i = 0;
-  while ( vars != scheme_null )
+  if (SCHEME_NULLP (bindings))
     {
-      scheme_add_binding (i, SCHEME_CAR(vars), scheme_eval (SCHEME_CAR (vals), env), env);
-      vars = SCHEME_CDR (vars);
-      vals = SCHEME_CDR (vals);
-      i++;
+      return (analyze_body (forms, env));
     }
-  forms = SCHEME_CDR (SCHEME_CDR (form));
-  /* process internal defines */
-  num_int_defs = 0;
-  vars = vals = vars_last = vals_last = scheme_null;
-  while (!SCHEME_NULLP(forms) && internal_def_p (SCHEME_CAR(forms)))
-    {
-      num_int_defs++;
-      aform = SCHEME_CAR (forms);
-      /* get var */
-      if (SCHEME_PAIRP (SCHEME_CAR (SCHEME_CDR (aform))))
-	{
-	  pair = scheme_make_pair (SCHEME_CAR (SCHEME_CAR (SCHEME_CDR (aform))), scheme_null);
-	}
-      else
-	{
-	  pair = scheme_make_pair (SCHEME_CAR (SCHEME_CDR (aform)), scheme_null);
-	}
-      if (SCHEME_NULLP (vars))
-	{
-	  vars = vars_last = pair;
-	}
-      else
-	{
-	  SCHEME_CDR (vars_last) = pair;
-	  vars_last = pair;
-	}
-      /* get val */
-      if (SCHEME_PAIRP (SCHEME_CAR (SCHEME_CDR (aform))))
-	{
-	  pair = CONS (CONS (scheme_lambda, CONS (SCHEME_CDR (SCHEME_CAR (SCHEME_CDR (aform))),
-						  SCHEME_CDR (SCHEME_CDR (aform)))),
-		       scheme_null);
-	}
-      else
-	{
-	  pair = scheme_make_pair (SCHEME_CAR (SCHEME_CDR (SCHEME_CDR (aform))), scheme_null);
-	}
-      if (SCHEME_NULLP (vals))
-	{
-	  vals = vals_last = pair;
-	}
-      else
-	{
-	  SCHEME_CDR (vals_last) = pair;
-	  vals_last = pair;
-	}
-      forms = SCHEME_CDR (forms);
-    }
-  if ( num_int_defs )
-    {
-      env = scheme_add_frame (vars, scheme_alloc_list (num_int_defs), env);
-      while (! SCHEME_NULLP (vars))
-	{
-	  scheme_set_value (SCHEME_CAR(vars),
-			    scheme_eval (SCHEME_CAR (vals), env),
-			    env);
-	  vars = SCHEME_CDR (vars);
-	  vals = SCHEME_CDR (vals);
-	}
-    }
-  /* evaluate non-internal-definition forms */
-  while (forms != scheme_null)
-    {
-      ret = scheme_eval (SCHEME_CAR (forms), env);
-      forms = SCHEME_CDR (forms);
-    }
-  /* pop internal define frame */
-  if ( num_int_defs )
-    {
-      env = scheme_pop_frame (env);
-    }
-  /* pop regular binding frame */
-  env = scheme_pop_frame (env);
-  return (ret);
+  SCHEME_ASSERT (SCHEME_PAIRP (bindings), "badly formed `let*' form");
+  node = scheme_make_node (SCHEME_LET_NODE);
+  node->num = 1;
+  node->syms = binding_symbols (bindings, 1, "let*");
+  node->nodes = binding_inits (bindings, 1, env);
+  env = scheme_new_scope (1, node->syms, env);
+  node->a = analyze_let_star (SCHEME_CDR (bindings), forms, env);
+  return (node);
 }
 
-static Scheme_Object *
+static Scheme_Node *
+let_star_syntax (Scheme_Object *form, Scheme_Env *env)
+{
+  SCHEME_ASSERT ((scheme_list_length(form) >= 3), "badly formed `let*' form");
+  return (analyze_let_star (SCHEME_CAR (SCHEME_CDR (form)),
+			    SCHEME_CDR (SCHEME_CDR (form)),
+			    env));
+}
+
+static Scheme_Node *
 letrec_syntax (Scheme_Object *form, Scheme_Env *env)
 {
-  Scheme_Object *bindings, *vars, *vals, *forms, *res;
-  Scheme_Object *vars_last, *vals_last, *pair, *aform;
-  int num_int_defs;
+  Scheme_Object *bindings;
+  Scheme_Node *node;
 
   SCHEME_ASSERT ((scheme_list_length(form) >= 3), "badly formed `letrec' form");
   bindings = SCHEME_CAR (SCHEME_CDR (form));
   SCHEME_ASSERT (SCHEME_PAIRP(bindings), "badly formed `letrec' form");
 
-  vars = scheme_map_1 (scheme_car, bindings);
-  vals = scheme_map_1 (scheme_cadr, bindings);
-
-  env = scheme_add_frame (vars, scheme_alloc_list (scheme_list_length (vars)), env);
-  while (! SCHEME_NULLP (vars))
-    {
-      scheme_set_value (SCHEME_CAR (vars),
-			scheme_eval (SCHEME_CAR (vals), env),
-			env);
-      vars = SCHEME_CDR (vars);
-      vals = SCHEME_CDR (vals);
-    }
-  forms = SCHEME_CDR (SCHEME_CDR (form));
-
-  /* process internal defines */
-  num_int_defs = 0;
-  vars = vals = vars_last = vals_last = scheme_null;
-  while (!SCHEME_NULLP(forms) && internal_def_p (SCHEME_CAR(forms)))
-    {
-      num_int_defs++;
-      aform = SCHEME_CAR (forms);
-      /* get var */
-      if (SCHEME_PAIRP (SCHEME_CAR (SCHEME_CDR (aform))))
-	{
-	  pair = scheme_make_pair (SCHEME_CAR (SCHEME_CAR (SCHEME_CDR (aform))), scheme_null);
-	}
-      else
-	{
-	  pair = scheme_make_pair (SCHEME_CAR (SCHEME_CDR (aform)), scheme_null);
-	}
-      if (SCHEME_NULLP (vars))
-	{
-	  vars = vars_last = pair;
-	}
-      else
-	{
-	  SCHEME_CDR (vars_last) = pair;
-	  vars_last = pair;
-	}
-      /* get val */
-      if (SCHEME_PAIRP (SCHEME_CAR (SCHEME_CDR (aform))))
-	{
-	  pair = CONS (CONS (scheme_lambda, CONS (SCHEME_CDR (SCHEME_CAR (SCHEME_CDR (aform))),
-						  SCHEME_CDR (SCHEME_CDR (aform)))),
-		       scheme_null);
-	}
-      else
-	{
-	  pair = scheme_make_pair (SCHEME_CAR (SCHEME_CDR (SCHEME_CDR (aform))), scheme_null);
-	}
-      if (SCHEME_NULLP (vals))
-	{
-	  vals = vals_last = pair;
-	}
-      else
-	{
-	  SCHEME_CDR (vals_last) = pair;
-	  vals_last = pair;
-	}
-      forms = SCHEME_CDR (forms);
-    }
-  if ( num_int_defs )
-    {
-      env = scheme_add_frame (vars, scheme_alloc_list (num_int_defs), env);
-      while (! SCHEME_NULLP (vars))
-	{
-	  scheme_set_value (SCHEME_CAR(vars),
-			    scheme_eval (SCHEME_CAR (vals), env),
-			    env);
-	  vars = SCHEME_CDR (vars);
-	  vals = SCHEME_CDR (vals);
-	}
-    }
-  while (! SCHEME_NULLP (forms))
-    {
-      res = scheme_eval (SCHEME_CAR (forms), env);
-      forms = SCHEME_CDR (forms);
-    }
-  /* pop internal define frame */
-  if ( num_int_defs )
-    {
-      env = scheme_pop_frame (env);
-    }
-  /* pop regular binding frame */
-  env = scheme_pop_frame (env);
-  return (res);
+  node = scheme_make_node (SCHEME_LETREC_NODE);
+  node->num = scheme_list_length (bindings);
+  node->syms = binding_symbols (bindings, node->num, "letrec");
+  env = scheme_new_scope (node->num, node->syms, env);
+  node->nodes = binding_inits (bindings, node->num, env);
+  node->a = analyze_body (SCHEME_CDR (SCHEME_CDR (form)), env);
+  return (node);
 }
 
-static Scheme_Object *
+static Scheme_Node *
 begin_syntax (Scheme_Object *form, Scheme_Env *env)
 {
-  Scheme_Object *forms, *ret;
-
-  ret = scheme_false;
-  forms = SCHEME_CDR (form);
-  while (forms != scheme_null)
-    {
-      ret = scheme_eval (SCHEME_CAR (forms), env);
-      forms = SCHEME_CDR (forms);
-    }
-  return (ret);
+  return (analyze_sequence (SCHEME_CDR (form), env));
 }
 
-static Scheme_Object *
+static Scheme_Node *
 do_syntax (Scheme_Object *form, Scheme_Env *env)
 {
-  Scheme_Object *second, *third;
-  Scheme_Object *vars, *inits, *steps;
-  Scheme_Object *test, *finals, *forms;
-  Scheme_Object *ret, *temp, *temp2;
-  Scheme_Object *step_first, *step_last, *clause, *pair;
+  Scheme_Object *second, *third, *clause, *forms;
+  Scheme_Env *scope;
+  Scheme_Node *node;
+  int i;
 
+  SCHEME_ASSERT ((scheme_list_length (form) >= 3), "badly formed `do' form");
   second = SCHEME_CAR (SCHEME_CDR (form));
-  vars = scheme_map_1 (scheme_car, second);
-  inits = scheme_map_1 (scheme_cadr, second);
-
-  /* We can't just map across the steps because
-     the could be missing. */
-  temp = second;
-  step_first = step_last = scheme_null;
-  while (! SCHEME_NULLP (temp))
-    {
-      clause = SCHEME_CAR (temp);
+  third = SCHEME_CAR (SCHEME_CDR (SCHEME_CDR (form)));
+  SCHEME_ASSERT (SCHEME_PAIRP (third), "do: bad test clause");
+  forms = SCHEME_CDR (SCHEME_CDR (SCHEME_CDR (form)));
+
+  node = scheme_make_node (SCHEME_DO_NODE);
+  node->num = scheme_list_length (second);
+  node->syms = binding_symbols (second, node->num, "do");
+  node->nodes = (Scheme_Node **) scheme_malloc ((2 * node->num + 1) * sizeof (Scheme_Node *));
+  scope = scheme_new_scope (node->num, node->syms, env);
+  for ( i=0 ; i<node->num ; ++i )
+    {
+      clause = SCHEME_CAR (second);
+      SCHEME_ASSERT (SCHEME_PAIRP (SCHEME_CDR (clause)), "do: bad variable clause");
+      node->nodes[i] = scheme_analyze (SCHEME_CADR (clause), env);
+      /* We can't just map across the steps because
+	 the could be missing. */
       if (SCHEME_NULLP (SCHEME_CDR (SCHEME_CDR (clause))))
 	{
-	  pair = scheme_make_pair (SCHEME_CAR (clause), scheme_null);
+	  node->nodes[node->num + i] = scheme_analyze (SCHEME_CAR (clause), scope);
 	}
       else
 	{
-	  pair = scheme_make_pair (SCHEME_CAR (SCHEME_CDR (SCHEME_CDR (clause))), scheme_null);
-	}
-      if (SCHEME_NULLP (step_first))
-	{
-	  step_first = step_last = pair;
+	  node->nodes[node->num + i] = scheme_analyze (SCHEME_CAR (SCHEME_CDDR (clause)), scope);
 	}
-      else
-	{
-	  SCHEME_CDR (step_last) = pair;
-	  step_last = pair;
-	}
-      temp = SCHEME_CDR (temp);
+      second = SCHEME_CDR (second);
     }
-  steps = step_first;
-
-  third = SCHEME_CAR (SCHEME_CDR (SCHEME_CDR (form)));
-  test = SCHEME_CAR (third);
-  finals = SCHEME_CDR (third);
-
-  forms = SCHEME_CDR (SCHEME_CDR (SCHEME_CDR (form)));
-
-  /* first evaluate the inits */
-  temp = inits;
-  while (! SCHEME_NULLP (temp))
+  node->a = scheme_analyze (SCHEME_CAR (third), scope);
+  if (! SCHEME_NULLP (SCHEME_CDR (third)))
     {
-      SCHEME_CAR(temp) = scheme_eval (SCHEME_CAR(temp), env);
-      temp = SCHEME_CDR (temp);
+      node->b = analyze_sequence (SCHEME_CDR (third), scope);
     }
-  /* bind the vars to the initial values */
-  env = scheme_add_frame (vars, inits, env);
-  
-  ret = scheme_null;
-  while (scheme_eval (test, env) == scheme_false)
+  if (! SCHEME_NULLP (forms))
     {
-      /* evaluate forms in body */
-      temp = forms;
-      while (! SCHEME_NULLP (temp))
-	{
-	  ret = scheme_eval (SCHEME_CAR(temp), env);
-	  temp = SCHEME_CDR (temp);
-	}
-      /* evaluate step expressions (all in the old env)
-	 and rebind the vars */
-      temp = steps;
-      step_first = step_last = scheme_null;
-      while (! SCHEME_NULLP (temp))
-	{
-	  pair = scheme_make_pair (scheme_eval (SCHEME_CAR(temp), env), scheme_null);
-	  if (step_first == scheme_null)
-	    {
-	      step_first = step_last = pair;
-	    }
-	  else
-	    {
-	      SCHEME_CDR (step_last) = pair;
-	      step_last = pair;
-	    }
-	  temp = SCHEME_CDR (temp);
-	}
-      env = scheme_pop_frame (env);
-      env = scheme_add_frame (vars, step_first, env);
-    }
-  /* evaluate the return forms */
-  temp = finals;
-  while (! SCHEME_NULLP (temp))
-    {
-      ret = scheme_eval (SCHEME_CAR (temp), env);
-      temp = SCHEME_CDR (temp);
+      node->c = analyze_sequence (forms, scope);
     }
-
-  /* pop the frame we've added */
-  env = scheme_pop_frame (env);
-  return (ret);
+  return (node);
 }
 
-static Scheme_Object *
+static Scheme_Node *
 delay_syntax (Scheme_Object *form, Scheme_Env *env)
 {
+  Scheme_Node *node;
+
   SCHEME_ASSERT ((scheme_list_length(form) == 2), "delay: bad form");
-  return (scheme_make_promise  (SCHEME_CAR (SCHEME_CDR (form)), env));
+  node = scheme_make_node (SCHEME_DELAY_NODE);
+  node->a = scheme_analyze (SCHEME_CAR (SCHEME_CDR (form)), env);
+  return (node);
 }
 
-static Scheme_Object *quasi (Scheme_Object *x, int level, Scheme_Env *env);
+static Scheme_Node *quasi (Scheme_Object *x, int level, Scheme_Env *env);
 
-static Scheme_Object *
+static Scheme_Node *
 quasiquote_syntax (Scheme_Object *form, Scheme_Env *env)
 {
-  Scheme_Object *template;
-
   SCHEME_ASSERT ((scheme_list_length (form) == 2), "quasiquote(`): wrong number of args");
   return (quasi (SCHEME_CAR (SCHEME_CDR (form)), 0, env));
 }
 
-static Scheme_Object *
+static Scheme_Node *
+quasi_call (Scheme_Object *prim, Scheme_Node *arg1, Scheme_Node *arg2)
+{
+  Scheme_Node *node;
+
+  node = scheme_make_node (SCHEME_APP_NODE);
+  node->a = scheme_make_const_node (prim);
+  node->num = (arg2 ? 2 : 1);
+  node->nodes = (Scheme_Node **) scheme_malloc (2 * sizeof (Scheme_Node *));
+  node->nodes[0] = arg1;
+  node->nodes[1] = arg2;
+  return (node);
+}
+
+/* Parts of the template that contain no unquotes are analyzed to
+   constants, so only the parts that depend on unquoted values get
+   rebuilt when the quasiquote form is run. */
+
+static Scheme_Node *
 quasi (Scheme_Object *x, int level, Scheme_Env *env)
 {
-  Scheme_Object *form, *list, *tail, *cell, *qcar, *qcdr, *ret;
+  Scheme_Node *qcar, *qcdr;
 
   if (SCHEME_VECTORP (x))
     {
-      x = scheme_vector_to_list (x);
-      x = quasi (x, level, env);
-      return (scheme_list_to_vector (x));
+      qcar = quasi (scheme_vector_to_list (x), level, env);
+      if (qcar->kind == SCHEME_CONST_NODE)
+	{
+	  return (scheme_make_const_node (x));
+	}
+      return (quasi_call (quasi_vector, qcar, NULL));
     }
   if (! SCHEME_PAIRP (x))
     {
-      return x;
+      return (scheme_make_const_node (x));
     }
   if (SCHEME_CAR (x) == scheme_unquote)
     {
@@ -810,77 +524,231 @@ quasi (Scheme_Object *x, int level, Scheme_Env *env)
       SCHEME_ASSERT (SCHEME_PAIRP (x), "bad unquote form");
       if (level) 
 	{
-	  ret = scheme_make_pair (SCHEME_CAR (x), scheme_null);
-	  ret = quasi (ret, level-1, env);
-	  ret = scheme_make_pair (scheme_unquote, ret);
+	  qcdr = quasi (scheme_make_pair (SCHEME_CAR (x), scheme_null), level-1, env);
+	  return (quasi_call (quasi_cons, scheme_make_const_node (scheme_unquote), qcdr));
         } 
-      else 
-	{
-	  ret = scheme_eval (SCHEME_CAR (x), env);
-	}
-      return ret;
+      return (scheme_analyze (SCHEME_CAR (x), env));
     } 
   else if (SCHEME_PAIRP (SCHEME_CAR (x))
 	   && SCHEME_CAR (SCHEME_CAR (x)) == scheme_unquote_splicing)
     {
-      qcdr = SCHEME_CDR (x);
-      form = list = tail = cell = scheme_null;
+      qcdr = quasi (SCHEME_CDR (x), level, env);
       x = SCHEME_CAR (x);
       SCHEME_ASSERT (SCHEME_PAIRP (SCHEME_CDR (x)), "bad unquote-splicing form");
       if (level) 
 	{
-	  list = quasi (SCHEME_CDR (x), level-1, env);
-	  list = scheme_make_pair (scheme_unquote_splicing, list);
-	  qcdr = quasi (qcdr, level, env);
-	  list = scheme_make_pair (list, qcdr);
-	  return list;
+	  qcar = quasi (SCHEME_CDR (x), level-1, env);
+	  qcar = quasi_call (quasi_cons, scheme_make_const_node (scheme_unquote_splicing), qcar);
+	  return (quasi_call (quasi_cons, qcar, qcdr));
 	}
-      form = scheme_eval (SCHEME_CAR (SCHEME_CDR (x)), env);
-      for ( ; SCHEME_PAIRP(form) ; tail = cell, form = SCHEME_CDR (form)) 
-	{
-	  cell = scheme_make_pair (SCHEME_CAR (form), scheme_null);
-	  if (SCHEME_NULLP (list))
-	    list = cell;
-	  else
-	    SCHEME_CDR(tail) = cell;
-	}
-      qcdr = quasi (qcdr, level, env);
-      if (SCHEME_NULLP (list))
-	{
-	  return qcdr;
-	}
-      SCHEME_CDR (tail) = qcdr;
-      return list;
+      qcar = scheme_analyze (SCHEME_CAR (SCHEME_CDR (x)), env);
+      return (quasi_call (quasi_append, qcar, qcdr));
     } 
   else 
     {
-      qcar = qcdr = scheme_null;
       if (SCHEME_CAR (x) == scheme_quasiquote)   /* hack! */
 	{
 	  ++level;
 	}
       qcar = quasi (SCHEME_CAR (x), level, env);
       qcdr = quasi (SCHEME_CDR (x), level, env);
-      list = scheme_make_pair (qcar, qcdr);
-      return list;
+      if (qcar->kind == SCHEME_CONST_NODE && qcar->obj == SCHEME_CAR (x)
+	  && qcdr->kind == SCHEME_CONST_NODE && qcdr->obj == SCHEME_CDR (x))
+	{
+	  return (scheme_make_const_node (x));
+	}
+      return (quasi_call (quasi_cons, qcar, qcdr));
     }
 }
 
 static Scheme_Object *
+quasi_cons_prim (int argc, Scheme_Object *argv[])
+{
+  return (scheme_make_pair (argv[0], argv[1]));
+}
+
+static Scheme_Object *
+quasi_append_prim (int argc, Scheme_Object *argv[])
+{
+  Scheme_Object *form, *list, *tail, *cell;
+
+  list = tail = scheme_null;
+  for ( form=argv[0] ; SCHEME_PAIRP(form) ; form=SCHEME_CDR (form) )
+    {
+      cell = scheme_make_pair (SCHEME_CAR (form), scheme_null);
+      if (SCHEME_NULLP (list))
+	list = cell;
+      else
+	SCHEME_CDR(tail) = cell;
+      tail = cell;
+    }
+  if (SCHEME_NULLP (list))
+    {
+      return (argv[1]);
+    }
+  SCHEME_CDR (tail) = argv[1];
+  return (list);
+}
+
+static Scheme_Object *
+quasi_vector_prim (int argc, Scheme_Object *argv[])
+{
+  return (scheme_list_to_vector (argv[0]));
+}
+
+static Scheme_Node *
 defmacro_syntax (Scheme_Object *form, Scheme_Env *env)
 {
   Scheme_Object *name, *code;
-  Scheme_Object *fun, *macro;
+  Scheme_Node *node;
 
   SCHEME_ASSERT ((scheme_list_length (form) > 3), "badly formed defmacro");
   name = SCHEME_CAR (SCHEME_CDR (form));
   SCHEME_ASSERT (SCHEME_SYMBOLP (name), "defmacro: second arg must be a symbol");
   code = SCHEME_CDR (SCHEME_CDR (form));
-  fun = scheme_make_closure (env, code);
+  node = scheme_make_node (SCHEME_DEFMACRO_NODE);
+  node->obj = name;
+  node->a = analyze_lambda (SCHEME_CAR (code), SCHEME_CDR (code), env);
+  return (node);
+}
   
-  macro = scheme_alloc_object ();
-  SCHEME_TYPE (macro) = scheme_macro_type;
-  SCHEME_PTR_VAL (macro) = fun;
-  scheme_add_global (SCHEME_STR_VAL (name), macro, env);
-  return (macro);
+/* analysis helpers */
+
+static Scheme_Node *
+analyze_lambda (Scheme_Object *params, Scheme_Object *forms, Scheme_Env *env)
+{
+  Scheme_Object **syms, *p;
+  Scheme_Node *node;
+  int num_params, i, rest;
+
+  SCHEME_ASSERT (SCHEME_PAIRP (forms), "badly formed lambda");
+  num_params = scheme_list_length (params);
+  rest = 0;
+  syms = (Scheme_Object **) scheme_malloc ((num_params + 1) * sizeof (Scheme_Object *));
+  p = params;
+  for ( i=0 ; i<num_params ; ++i )
+    {
+      if (SCHEME_PAIRP (p))
+	{
+	  syms[i] = SCHEME_CAR (p);
+	  p = SCHEME_CDR (p);
+	}
+      else
+	{
+	  syms[i] = p;
+	  rest = 1;
+	}
+      SCHEME_ASSERT (SCHEME_SYMBOLP (syms[i]), "lambda: parameters must be symbols");
+    }
+  node = scheme_make_node (SCHEME_LAMBDA_NODE);
+  node->obj = params;
+  node->num = num_params;
+  node->syms = syms;
+  node->flags = (rest ? SCHEME_REST_PARAM : 0);
+  node->a = analyze_body (forms, scheme_new_scope (num_params, syms, env));
+  return (node);
+}
+
+/* A body's leading defines bind internal variables, which are
+   collected into a letrec-style frame around the rest of the body. */
+
+static Scheme_Node *
+analyze_body (Scheme_Object *forms, Scheme_Env *env)
+{
+  Scheme_Object *f, *aform, *sec;
+  Scheme_Node *node;
+  int num_int_defs, i;
+
+  num_int_defs = 0;
+  for ( f=forms ; SCHEME_PAIRP (f) && internal_def_p (SCHEME_CAR (f)) ; f=SCHEME_CDR (f) )
+    {
+      SCHEME_ASSERT (SCHEME_PAIRP (SCHEME_CDR (SCHEME_CAR (f))), "badly formed define");
+      num_int_defs++;
+    }
+  if (! num_int_defs)
+    {
+      return (analyze_sequence (forms, env));
+    }
+
+  node = scheme_make_node (SCHEME_LETREC_NODE);
+  node->num = num_int_defs;
+  node->syms = (Scheme_Object **) scheme_malloc (num_int_defs * sizeof (Scheme_Object *));
+  node->nodes = (Scheme_Node **) scheme_malloc (num_int_defs * sizeof (Scheme_Node *));
+  for ( f=forms, i=0 ; i<num_int_defs ; f=SCHEME_CDR (f), ++i )
+    {
+      sec = SCHEME_CAR (SCHEME_CDR (SCHEME_CAR (f)));
+      node->syms[i] = (SCHEME_PAIRP (sec) ? SCHEME_CAR (sec) : sec);
+      SCHEME_ASSERT (SCHEME_SYMBOLP (node->syms[i]), "define: variable must be a symbol");
+    }
+  env = scheme_new_scope (num_int_defs, node->syms, env);
+  for ( i=0 ; i<num_int_defs ; forms=SCHEME_CDR (forms), ++i )
+    {
+      aform = SCHEME_CAR (forms);
+      sec = SCHEME_CAR (SCHEME_CDR (aform));
+      if (SCHEME_PAIRP (sec))
+	{
+	  node->nodes[i] = analyze_lambda (SCHEME_CDR (sec), SCHEME_CDDR (aform), env);
+	}
+      else
+	{
+	  SCHEME_ASSERT (SCHEME_PAIRP (SCHEME_CDDR (aform)), "define: no value for variable");
+	  node->nodes[i] = scheme_analyze (SCHEME_CAR (SCHEME_CDDR (aform)), env);
+	}
+    }
+  node->a = analyze_sequence (forms, env);
+  return (node);
+}
+
+static Scheme_Node *
+analyze_sequence (Scheme_Object *forms, Scheme_Env *env)
+{
+  Scheme_Node *node;
+
+  if (SCHEME_PAIRP (forms) && SCHEME_NULLP (SCHEME_CDR (forms)))
+    {
+      return (scheme_analyze (SCHEME_CAR (forms), env));
+    }
+  node = scheme_make_node (SCHEME_SEQ_NODE);
+  node->num = scheme_list_length (forms);
+  node->nodes = scheme_analyze_list (forms, node->num, env);
+  return (node);
+}
+
+static Scheme_Object **
+binding_symbols (Scheme_Object *bindings, int num, char *who)
+{
+  Scheme_Object **syms, *binding;
+  int i;
+
+  syms = (Scheme_Object **) scheme_malloc ((num + 1) * sizeof (Scheme_Object *));
+  for ( i=0 ; i<num ; ++i )
+    {
+      SCHEME_ASSERT (SCHEME_PAIRP (bindings), "badly formed binding list");
+      binding = SCHEME_CAR (bindings);
+      if (! SCHEME_PAIRP (binding) || ! SCHEME_SYMBOLP (SCHEME_CAR (binding)))
+	{
+	  scheme_signal_error ("%s: badly formed binding", who);
+	}
+      syms[i] = SCHEME_CAR (binding);
+      bindings = SCHEME_CDR (bindings);
+    }
+  return (syms);
+}
+
+static Scheme_Node **
+binding_inits (Scheme_Object *bindings, int num, Scheme_Env *env)
+{
+  Scheme_Node **nodes;
+  Scheme_Object *binding;
+  int i;
+
+  nodes = (Scheme_Node **) scheme_malloc ((num + 1) * sizeof (Scheme_Node *));
+  for ( i=0 ; i<num ; ++i )
+    {
+      binding = SCHEME_CAR (bindings);
+      SCHEME_ASSERT (SCHEME_PAIRP (SCHEME_CDR (binding)), "badly formed binding");
+      nodes[i] = scheme_analyze (SCHEME_CADR (binding), env);
+      bindings = SCHEME_CDR (bindings);
+    }
+  return (nodes);
 }
@@ -26,22 +26,51 @@
 #include <string.h>
 
 Scheme_Object *scheme_type_type;
+Scheme_Object *scheme_tag_types[32];
 
 void
 scheme_init_type (Scheme_Env *env)
 {
   scheme_type_type = scheme_make_type ("<type>");
-  SCHEME_TYPE (scheme_type_type) = scheme_type_type;
+  _SCHEME_TYPE (scheme_type_type) = scheme_type_type;
   scheme_add_global ("<type>", scheme_type_type, env);
 }
 
 Scheme_Object *
 scheme_make_type (char *name)
+{
+  return (scheme_make_layout_type (name, SCHEME_LAYOUT_ALL));
+}
+
+/* A type whose objects hold heap pointers only in the words of
+   layout, for scheme_alloc_typed_object(). */
+
+Scheme_Object *
+scheme_make_layout_type (char *name, int layout)
 {
   Scheme_Object *type;
 
   type = scheme_alloc_object ();
-  SCHEME_TYPE(type) = scheme_type_type;
+  _SCHEME_TYPE(type) = scheme_type_type;
   SCHEME_STR_VAL(type) = scheme_strdup (name);
+  SCHEME_TYPE_LAYOUT(type) = layout;
   return (type);
 }
+
+/* Make type the type of every tagged object whose low bits match
+   those of obj; bits is how many of them count. */
+
+void
+scheme_set_tag_type (Scheme_Object *obj, int bits, Scheme_Object *type)
+{
+  int mask, i;
+
+  mask = (1 << bits) - 1;
+  for ( i=0 ; i<32 ; ++i )
+    {
+      if ((i & mask) == (((intptr_t) obj) & mask))
+	{
+	  scheme_tag_types[i] = type;
+	}
+    }
+}
@@ -64,10 +64,7 @@ scheme_make_vector (int size, Scheme_Object *fill)
   Scheme_Object *vec;
   int i;
 
-  vec = scheme_alloc_object ();
-  SCHEME_TYPE(vec) = scheme_vector_type;
-  SCHEME_VEC_SIZE(vec) = size;
-  SCHEME_VEC_ELS(vec) = (Scheme_Object**)scheme_malloc(sizeof(Scheme_Object*)*size);
+  vec = scheme_alloc_vector (scheme_vector_type, size);
   for ( i=0 ; i<size ; ++i )
     {
       SCHEME_VEC_ELS(vec)[i] = fill;
@@ -75,6 +72,22 @@ scheme_make_vector (int size, Scheme_Object *fill)
   return (vec);
 }
 
+/* The elements of a vector follow its object in the same block.
+   Structure instances are laid out the same way with their own
+   type. */
+
+Scheme_Object *
+scheme_alloc_vector (Scheme_Object *type, int size)
+{
+  Scheme_Object *vec;
+
+  vec = (Scheme_Object *) scheme_malloc (sizeof (Scheme_Object)
+					 + sizeof (Scheme_Object *) * size);
+  _SCHEME_TYPE(vec) = type;
+  SCHEME_VEC_SIZE(vec) = size;
+  return (vec);
+}
+
 /* locals */
 
 static Scheme_Object *
@@ -0,0 +1,203 @@
+/*
+  libscheme
+  Copyright (c) 1994 Brent Benson
+  All rights reserved.
+
+  Permission is hereby granted, without written agreement and without
+  license or royalty fees, to use, copy, modify, and distribute this
+  software and its documentation for any purpose, provided that the
+  above copyright notice and the following two paragraphs appear in
+  all copies of this software.
+
+  IN NO EVENT SHALL BRENT BENSON BE LIABLE TO ANY PARTY FOR DIRECT,
+  INDIRECT, SPECIAL, INCIDENTAL, OR CONSEQUENTIAL DAMAGES ARISING OUT
+  OF THE USE OF THIS SOFTWARE AND ITS DOCUMENTATION, EVEN IF BRENT
+  BENSON HAS BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+  BRENT BENSON SPECIFICALLY DISCLAIMS ANY WARRANTIES, INCLUDING, BUT
+  NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+  FITNESS FOR A PARTICULAR PURPOSE.  THE SOFTWARE PROVIDED HEREUNDER
+  IS ON AN "AS IS" BASIS, AND BRENT BENSON HAS NO OBLIGATION TO
+  PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR
+  MODIFICATIONS.
+*/
+
+/* Weak boxes and weak hash tables.
+
+   A weak box holds its value in a word outside its type's layout,
+   which the collector does not scan, and has the collector clear it
+   once the value is otherwise unreachable.  Weak hash tables are
+   Scheme_Weak_Tables, keyed by eq?. */
+
+#include "scheme.h"
+
+#define WEAK_TABLE_SIZE 31
+
+/* globals */
+Scheme_Object *scheme_weak_box_type;
+Scheme_Object *scheme_weak_table_type;
+
+/* locals */
+static Scheme_Object *make_weak_box (int argc, Scheme_Object *argv[]);
+static Scheme_Object *weak_box_p (int argc, Scheme_Object *argv[]);
+static Scheme_Object *weak_box_value (int argc, Scheme_Object *argv[]);
+static Scheme_Object *make_weak_hash_table (int argc, Scheme_Object *argv[]);
+static Scheme_Object *weak_hash_table_p (int argc, Scheme_Object *argv[]);
+static Scheme_Object *weak_hash_table_ref (int argc, Scheme_Object *argv[]);
+static Scheme_Object *weak_hash_table_set (int argc, Scheme_Object *argv[]);
+static Scheme_Object *weak_hash_table_remove (int argc, Scheme_Object *argv[]);
+static Scheme_Object *weak_hash_table_count (int argc, Scheme_Object *argv[]);
+
+void
+scheme_init_weak (Scheme_Env *env)
+{
+  scheme_weak_box_type = scheme_make_layout_type ("<weak-box>", SCHEME_LAYOUT_NONE);
+  scheme_weak_table_type = scheme_make_layout_type ("<weak-hash-table>", SCHEME_LAYOUT_PTR1);
+  scheme_add_global ("<weak-box>", scheme_weak_box_type, env);
+  scheme_add_global ("<weak-hash-table>", scheme_weak_table_type, env);
+  scheme_add_global ("make-weak-box", scheme_make_prim (make_weak_box), env);
+  scheme_add_global ("weak-box?", scheme_make_prim (weak_box_p), env);
+  scheme_add_global ("weak-box-value", scheme_make_prim (weak_box_value), env);
+  scheme_add_global ("make-weak-hash-table", scheme_make_prim (make_weak_hash_table), env);
+  scheme_add_global ("weak-hash-table?", scheme_make_prim (weak_hash_table_p), env);
+  scheme_add_global ("weak-hash-table-ref", scheme_make_prim (weak_hash_table_ref), env);
+  scheme_add_global ("weak-hash-table-set!", scheme_make_prim (weak_hash_table_set), env);
+  scheme_add_global ("weak-hash-table-remove!", scheme_make_prim (weak_hash_table_remove), env);
+  scheme_add_global ("weak-hash-table-count", scheme_make_prim (weak_hash_table_count), env);
+}
+
+Scheme_Object *
+scheme_make_weak_box (Scheme_Object *val)
+{
+  Scheme_Object *box;
+
+  box = scheme_alloc_typed_object (scheme_weak_box_type);
+  SCHEME_PTR_VAL (box) = val;
+  scheme_weak_link (&SCHEME_PTR_VAL (box), val);
+  return (box);
+}
+
+/* The value of box, or NULL if it has been collected. */
+
+Scheme_Object *
+scheme_weak_box_value (Scheme_Object *box)
+{
+  return ((Scheme_Object *) scheme_weak_value (&SCHEME_PTR_VAL (box)));
+}
+
+Scheme_Object *
+scheme_make_weak_hash_table (int size)
+{
+  Scheme_Object *table;
+  Scheme_Weak_Table *weak;
+
+  weak = scheme_weak_table (size);
+  table = scheme_alloc_typed_object (scheme_weak_table_type);
+  SCHEME_PTR_VAL (table) = weak;
+  return (table);
+}
+
+/* locals */
+
+static Scheme_Object *
+make_weak_box (int argc, Scheme_Object *argv[])
+{
+  SCHEME_ASSERT ((argc == 1), "make-weak-box: wrong number of args");
+  return (scheme_make_weak_box (argv[0]));
+}
+
+static Scheme_Object *
+weak_box_p (int argc, Scheme_Object *argv[])
+{
+  SCHEME_ASSERT ((argc == 1), "weak-box?: wrong number of args");
+  return (SCHEME_WEAK_BOXP (argv[0]) ? scheme_true : scheme_false);
+}
+
+/* (weak-box-value box [default]) returns default, or #f, once the
+   value has been collected. */
+
+static Scheme_Object *
+weak_box_value (int argc, Scheme_Object *argv[])
+{
+  Scheme_Object *val;
+
+  SCHEME_ASSERT ((argc == 1 || argc == 2), "weak-box-value: wrong number of args");
+  SCHEME_ASSERT (SCHEME_WEAK_BOXP (argv[0]), "weak-box-value: first arg must be a weak box");
+  val = scheme_weak_box_value (argv[0]);
+  if (! val)
+    {
+      return (argc == 2 ? argv[1] : scheme_false);
+    }
+  return (val);
+}
+
+static Scheme_Object *
+make_weak_hash_table (int argc, Scheme_Object *argv[])
+{
+  int size;
+
+  SCHEME_ASSERT ((argc == 0 || argc == 1), "make-weak-hash-table: wrong number of args");
+  size = WEAK_TABLE_SIZE;
+  if (argc == 1)
+    {
+      SCHEME_ASSERT ((SCHEME_INTP (argv[0]) && SCHEME_INT_VAL (argv[0]) > 0),
+		     "make-weak-hash-table: arg must be a positive integer");
+      size = SCHEME_INT_VAL (argv[0]);
+    }
+  return (scheme_make_weak_hash_table (size));
+}
+
+static Scheme_Object *
+weak_hash_table_p (int argc, Scheme_Object *argv[])
+{
+  SCHEME_ASSERT ((argc == 1), "weak-hash-table?: wrong number of args");
+  return (SCHEME_WEAK_TABLEP (argv[0]) ? scheme_true : scheme_false);
+}
+
+/* (weak-hash-table-ref table key [default]) returns default, or #f,
+   if key is not in table. */
+
+static Scheme_Object *
+weak_hash_table_ref (int argc, Scheme_Object *argv[])
+{
+  Scheme_Object *val;
+
+  SCHEME_ASSERT ((argc == 2 || argc == 3), "weak-hash-table-ref: wrong number of args");
+  SCHEME_ASSERT (SCHEME_WEAK_TABLEP (argv[0]),
+		 "weak-hash-table-ref: first arg must be a weak hash table");
+  val = (Scheme_Object *) scheme_lookup_in_weak_table (SCHEME_PTR_VAL (argv[0]), argv[1]);
+  if (! val)
+    {
+      return (argc == 3 ? argv[2] : scheme_false);
+    }
+  return (val);
+}
+
+static Scheme_Object *
+weak_hash_table_set (int argc, Scheme_Object *argv[])
+{
+  SCHEME_ASSERT ((argc == 3), "weak-hash-table-set!: wrong number of args");
+  SCHEME_ASSERT (SCHEME_WEAK_TABLEP (argv[0]),
+		 "weak-hash-table-set!: first arg must be a weak hash table");
+  scheme_add_to_weak_table (SCHEME_PTR_VAL (argv[0]), argv[1], argv[2]);
+  return (argv[2]);
+}
+
+static Scheme_Object *
+weak_hash_table_remove (int argc, Scheme_Object *argv[])
+{
+  SCHEME_ASSERT ((argc == 2), "weak-hash-table-remove!: wrong number of args");
+  SCHEME_ASSERT (SCHEME_WEAK_TABLEP (argv[0]),
+		 "weak-hash-table-remove!: first arg must be a weak hash table");
+  scheme_remove_from_weak_table (SCHEME_PTR_VAL (argv[0]), argv[1]);
+  return (argv[1]);
+}
+
+static Scheme_Object *
+weak_hash_table_count (int argc, Scheme_Object *argv[])
+{
+  SCHEME_ASSERT ((argc == 1), "weak-hash-table-count: wrong number of args");
+  SCHEME_ASSERT (SCHEME_WEAK_TABLEP (argv[0]),
+		 "weak-hash-table-count: arg must be a weak hash table");
+  return (scheme_make_integer (scheme_weak_table_count (SCHEME_PTR_VAL (argv[0]))));
+}